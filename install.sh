@@ -46,8 +46,9 @@ if [ $choice = 1 ]; then
   git reset --hard $NS3_MMWAVE_LAST_COMMIT
   patch -p1 < ../.patches/ns3-mmwave-psc.patch
 
-  # Copy the example
+  # Copy the example and its scale-out variant
   cp ../psc-scenarios/chemical-plant-scenario.cc scratch/.
+  cp ../psc-scenarios/chemical-plant-scale-out.cc scratch/.
 
   # Configure the ns3-module
   ./waf configure --disable-python
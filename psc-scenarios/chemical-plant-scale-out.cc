@@ -0,0 +1,580 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2019, University of Padova, Dep. of Information Engineering, SIGNET lab.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Scale-out variant of the chemical plant scenario, for mutual-aid incidents.
+ * The plant is tiled with numZonesX x numZonesY incident zones. Each zone has
+ * its own incident area (with a wheelbarrow robot), LTE anchor, mmWave sites
+ * and first responders. The X2 interfaces are only set up within a zone, and
+ * the UEs of a zone are attached to the closest BSs of that zone, so that the
+ * setup cost grows with the size of a zone instead of the size of the plant.
+ * The wall-clock time of each setup stage, the peak memory and the simulated
+ * seconds per wall-clock second are written to scale-out-stats.txt.
+ */
+
+#include <ns3/mmwave-helper.h>
+#include <scratch/simulation-config/ps-simulation-config.h>
+#include <chrono>
+
+using namespace ns3;
+using namespace mmwave;
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t runSet = 1;
+  uint32_t seedSet = 1;
+  std::string filePath = ""; // path of the output files
+  uint32_t simTime = 1000; // simulation time in milliseconds
+
+  double frequency = 30e9; // operating frequency
+  double bandwidth = 1e9; // system bandwidth
+
+  // APPLICATIONS
+  uint32_t wheelbarrowAppStart = 500; // wheelbarrow robot applications start time in milliseconds
+  uint32_t firstRespondersAppStart = 500; // first responders applications start time in milliseconds
+  double firstRespondersVideoRate = 600e3; // data rate of the applications installed in the first responders [bit/s]
+  double ratioDlFlows = 0.5; // ratio between UL and DL flows
+  double wheelbarrowVideoRate = 4000e3; // data rate of the video application installed in the wheelbarrow robot [bit/s]
+  double wheelbarrowCtrlRate = 50e3; // data rate of the application which controls the wheelbarrow robot [bit/s]
+  bool wheelbarrowCtrlOnLte = true; // if true, send the traffic to control the wheelbarrow robot through LTE
+  double packetSize = 1024; // packet size [bytes]
+  bool flowStats = true; // if true, collect per-flow delay, jitter and loss statistics instead of the application traces
+  uint32_t flowStatsInterval = 0; // interval between two dumps of the flow statistics in milliseconds, if 0 dump only at the end
+  bool profileEvents = false; // if true, profile the wall time of the scheduled events
+  uint32_t profileBin = 100; // width of the bins of the event timeline in milliseconds
+  bool videoFrames = false; // if true, the video feeds send whole frames at the frame rate instead of constant bit rate packets
+  uint32_t mobilityInterval = 1000; // interval between two samples of the node positions in milliseconds, if 0 the positions are not sampled
+  std::string mobilityNodes = "ues"; // nodes whose positions are sampled, "ues" or "all"
+  uint32_t forkRuns = 0; // number of runs forked at the warm start checkpoint, if 0 the warm start is disabled
+  uint32_t forkAt = 400; // time of the warm start checkpoint in milliseconds, after the network attach
+  double convergencePrecision = 0; // relative half-width of the 95% confidence intervals of the KPIs at which the run stops, if 0 the run is not stopped early
+  std::string convergenceMetrics = "throughput,delay"; // KPIs of the early stop, comma-separated list of throughput and delay
+  uint32_t convergenceBatch = 100; // length of the batches of the early stop in milliseconds
+  uint32_t convergenceMinTime = 0; // minimum simulation time in milliseconds before an early stop
+  uint32_t memoryInterval = 0; // interval between two samples of the memory of the process in milliseconds, if 0 the memory is not sampled
+  uint32_t associationInterval = 0; // interval between two checks of the closest BS of each UE in milliseconds, if 0 the association is not checked
+  uint32_t traceWindow = 0; // window of the aggregated PHY, RLC and PDCP traces in milliseconds, if 0 the full traces are written
+  std::string traceDetailLayers = ""; // layers whose received PDUs are still written in full with traceWindow, comma-separated list of phy, rlc, pdcp and buffer
+  std::string traceDetailRntis = ""; // RNTIs whose PDUs are written in full for traceDetailLayers, comma-separated, if empty all the RNTIs
+  uint32_t traceBufferInterval = 0; // interval between two samples of the RLC buffers with traceWindow in milliseconds, if 0 the buffers are not sampled
+  bool enableTraces = false; // if true, enable the PHY, MAC, RLC and PDCP traces of the mmwave module
+
+  // LAYOUT
+  uint32_t numZonesX = 2; // number of incident zones along x
+  uint32_t numZonesY = 2; // number of incident zones along y
+  double zoneSide = 1000.0; // dimension of an incident zone in meters
+  double incidentAreaRadius = 200.0; // radius of the incident area of each zone in meters
+  double minBuildingSize = 50.0; // minimum dimension of a building in meters
+  double maxBuildingSize = 300.0; // maximum dimension of a building in meters
+  uint32_t numOfBuildingsPerZone = 10; // number of buildings in each zone
+
+  uint32_t numOfMmWaveBsPerZone = 5; // number of mmwave base stations in each zone
+  double minInterSiteDistance = 60.0; // minimum intersite distance between the bs
+
+  uint32_t numFirstRespondersPerZone = 10; // number of first responders in each zone
+
+  // BS ANTENNA PARAMETERS
+  uint32_t numBsAntennaElements = 64; // number of BS antenna elements
+  double mmWaveBsHeight = 10.0; // mmwave site height
+  double lteBsHeight = 30.0; // LTE bs height
+
+  // UE ANTENNA PARAMETERS
+  uint32_t numUeAntennaElements = 16; // number of UE antenna elements
+  double ueAntennaHeight = 1.5; // UE antenna height
+
+  // RLC PARAMETERS
+  bool rlcAm = true; // if true use RLC AM, if false use RLC UM
+  uint32_t rlcBufSize = 10; // RLC buffer size
+  double rlcTxBudget = 0; // MB divided evenly into the cap of the transmission buffer of each RLC entity, if 0 each buffer has rlcBufSize MB
+
+  // MULTI-CONNECTIVITY PARAMETERS
+  std::string steeringPolicy = "qci-threshold"; // policy which splits the downlink SDUs between LTE and mmWave, qci-threshold, fixed-split or queue-delay
+  double lteSplitRatio = 0.5; // share of the downlink bytes sent on LTE with the fixed-split policy
+  uint32_t lteMaxQueueDelay = 10; // maximum queueing delay in the LTE RLC buffer with the queue-delay policy in milliseconds
+  std::string qciSteeringTable = ""; // comma-separated list of qci:lteShare, the bearers with these QCIs use a fixed split with their share
+  bool steeringStats = false; // if true, write the per-bearer steering statistics to steering-stats.txt
+
+  CommandLine cmd;
+  cmd.AddValue ("filePath", "path for the output files", filePath);
+  cmd.AddValue ("simTime", "simulation time in milliseconds", simTime);
+  cmd.AddValue ("runSet", "run set", runSet);
+  cmd.AddValue ("seedSet", "seed set", seedSet);
+  cmd.AddValue ("wheelbarrowAppStart", "wheelbarrow robot applications start time in milliseconds", wheelbarrowAppStart);
+  cmd.AddValue ("firstRespondersAppStart", "first responders applications start time in milliseconds", firstRespondersAppStart);
+  cmd.AddValue ("firstRespondersVideoRate", "data rate of the applications installed in the first responders [bit/s]", firstRespondersVideoRate);
+  cmd.AddValue ("wheelbarrowVideoRate", "data rate of the video application installed in the wheelbarrow robot [bit/s]", wheelbarrowVideoRate);
+  cmd.AddValue ("wheelbarrowCtrlRate", "data rate of the application which controls the wheelbarrow robot [bit/s]", wheelbarrowCtrlRate);
+  cmd.AddValue ("wheelbarrowCtrlOnLte", "if true, send the traffic to control the wheelbarrow robot through LTE", wheelbarrowCtrlOnLte);
+  cmd.AddValue ("packetSize", "packet size [bytes]", packetSize);
+  cmd.AddValue ("flowStats", "if true, collect per-flow delay, jitter and loss statistics instead of the application traces", flowStats);
+  cmd.AddValue ("flowStatsInterval", "interval between two dumps of the flow statistics in milliseconds, if 0 dump only at the end", flowStatsInterval);
+  cmd.AddValue ("profileEvents", "if true, profile the wall time of the scheduled events", profileEvents);
+  cmd.AddValue ("profileBin", "width of the bins of the event timeline in milliseconds", profileBin);
+  cmd.AddValue ("videoFrames", "if true, the video feeds send whole frames at the frame rate instead of constant bit rate packets", videoFrames);
+  cmd.AddValue ("mobilityInterval", "interval between two samples of the node positions in milliseconds, if 0 the positions are not sampled", mobilityInterval);
+  cmd.AddValue ("mobilityNodes", "nodes whose positions are sampled, ues or all", mobilityNodes);
+  cmd.AddValue ("forkRuns", "number of runs forked at the warm start checkpoint, if 0 the warm start is disabled", forkRuns);
+  cmd.AddValue ("forkAt", "time of the warm start checkpoint in milliseconds, after the network attach", forkAt);
+  cmd.AddValue ("convergencePrecision", "relative half-width of the 95% confidence intervals of the KPIs at which the run stops, if 0 the run is not stopped early", convergencePrecision);
+  cmd.AddValue ("convergenceMetrics", "KPIs of the early stop, comma-separated list of throughput and delay", convergenceMetrics);
+  cmd.AddValue ("convergenceBatch", "length of the batches of the early stop in milliseconds", convergenceBatch);
+  cmd.AddValue ("convergenceMinTime", "minimum simulation time in milliseconds before an early stop", convergenceMinTime);
+  cmd.AddValue ("memoryInterval", "interval between two samples of the memory of the process in milliseconds, if 0 the memory is not sampled", memoryInterval);
+  cmd.AddValue ("associationInterval", "interval between two checks of the closest BS of each UE in milliseconds, if 0 the association is not checked", associationInterval);
+  cmd.AddValue ("traceWindow", "window of the aggregated PHY, RLC and PDCP traces in milliseconds, if 0 the full traces are written", traceWindow);
+  cmd.AddValue ("traceDetailLayers", "layers whose received PDUs are still written in full with traceWindow, comma-separated list of phy, rlc, pdcp and buffer", traceDetailLayers);
+  cmd.AddValue ("traceDetailRntis", "RNTIs whose PDUs are written in full for traceDetailLayers, comma-separated, if empty all the RNTIs", traceDetailRntis);
+  cmd.AddValue ("traceBufferInterval", "interval between two samples of the RLC buffers with traceWindow in milliseconds, if 0 the buffers are not sampled", traceBufferInterval);
+  cmd.AddValue ("enableTraces", "if true, enable the PHY, MAC, RLC and PDCP traces of the mmwave module", enableTraces);
+  cmd.AddValue ("numZonesX", "number of incident zones along x", numZonesX);
+  cmd.AddValue ("numZonesY", "number of incident zones along y", numZonesY);
+  cmd.AddValue ("zoneSide", "dimension of an incident zone in meters", zoneSide);
+  cmd.AddValue ("incidentAreaRadius", "radius of the incident area of each zone in meters", incidentAreaRadius);
+  cmd.AddValue ("minBuildingSize", "minimum dimension of a building in meters", minBuildingSize);
+  cmd.AddValue ("maxBuildingSize", "maximum dimension of a building in meters", maxBuildingSize);
+  cmd.AddValue ("numOfBuildingsPerZone", "number of buildings in each zone", numOfBuildingsPerZone);
+  cmd.AddValue ("numOfMmWaveBsPerZone", "number of mmwave base stations in each zone", numOfMmWaveBsPerZone);
+  cmd.AddValue ("mmWaveBsHeight", "height of the mmwave base stations", mmWaveBsHeight);
+  cmd.AddValue ("lteBsHeight", "height of the lte base stations", lteBsHeight);
+  cmd.AddValue ("minInterSiteDistance", "minimum intersite distance between the bs", minInterSiteDistance);
+  cmd.AddValue ("numFirstRespondersPerZone", "number of first responders in each zone", numFirstRespondersPerZone);
+  cmd.AddValue ("ueAntennaHeight", "UE antenna height", ueAntennaHeight);
+  cmd.AddValue ("ratioDlFlows", "ratio between UL and DL flows", ratioDlFlows);
+  cmd.AddValue ("numBsAntennaElements", "number of BS antenna elements", numBsAntennaElements);
+  cmd.AddValue ("numUeAntennaElements", "number of UE antenna elements", numUeAntennaElements);
+  cmd.AddValue ("rlcAm", "if true use RLC AM, if false use RLC UM", rlcAm);
+  cmd.AddValue ("rlcBufSize", "RLC buffer size", rlcBufSize);
+  cmd.AddValue ("rlcTxBudget", "MB divided evenly into the cap of the transmission buffer of each RLC entity, if 0 each buffer has rlcBufSize MB", rlcTxBudget);
+  cmd.AddValue ("steeringPolicy", "policy which splits the downlink SDUs between LTE and mmWave, qci-threshold, fixed-split or queue-delay", steeringPolicy);
+  cmd.AddValue ("lteSplitRatio", "share of the downlink bytes sent on LTE with the fixed-split policy", lteSplitRatio);
+  cmd.AddValue ("lteMaxQueueDelay", "maximum queueing delay in the LTE RLC buffer with the queue-delay policy in milliseconds", lteMaxQueueDelay);
+  cmd.AddValue ("qciSteeringTable", "comma-separated list of qci:lteShare, the bearers with these QCIs use a fixed split with their share", qciSteeringTable);
+  cmd.AddValue ("steeringStats", "if true, write the per-bearer steering statistics to steering-stats.txt", steeringStats);
+  cmd.AddValue ("frequency", "operating frequency", frequency);
+  cmd.AddValue ("bandwidth", "system bandwidth", bandwidth);
+  cmd.Parse (argc, argv);
+
+  if (profileEvents)
+  {
+    // EventProfile.txt and EventTimeline.txt are written when Simulator::Run returns
+    PsSimulationConfig::EnableEventProfiler (filePath, MilliSeconds (profileBin));
+  }
+
+  if (forkRuns > 0)
+  {
+    // at forkAt the process forks forkRuns children with runs runSet, runSet + 1, ...,
+    // which continue the simulation and write their outputs in filePath/fork-<i>/
+    NS_ABORT_MSG_IF (profileEvents, "The event profiler can't be used with the warm start");
+    // the files of the full traces and of the RLC AM buffer are opened by the modules and can't be moved in fork-<i>/
+    NS_ABORT_MSG_IF (enableTraces && traceWindow == 0, "The full traces can't be used with the warm start, use traceWindow");
+    NS_ABORT_MSG_IF (traceDetailLayers.find ("buffer") != std::string::npos, "The buffer trace layer can't be used with the warm start");
+    NS_ABORT_MSG_IF (forkAt >= simTime, "The warm start checkpoint must be before the end of the simulation");
+    WarmStart::Enable (MilliSeconds (forkAt), forkRuns, filePath, runSet);
+  }
+
+  uint32_t numZones = numZonesX * numZonesY;
+  uint32_t numUesPerZone = numFirstRespondersPerZone + 1; // the first responders and the wheelbarrow robot
+  NS_ABORT_MSG_IF (numZones == 0, "At least one incident zone is needed");
+  NS_ABORT_MSG_IF (1236 + numZones * (numFirstRespondersPerZone + 1) > 65535, "Not enough ports on the remote host for all the flows");
+
+  // wall-clock time and peak memory of each setup stage
+  std::chrono::steady_clock::time_point setupStart = std::chrono::steady_clock::now ();
+  std::chrono::steady_clock::time_point stageStart = setupStart;
+  std::vector<std::pair<std::string, std::pair<double, double> > > setupStages;
+  auto endStage = [&] (std::string stage)
+  {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now ();
+    double elapsed = std::chrono::duration<double> (now - stageStart).count ();
+    setupStages.push_back (std::make_pair (stage, std::make_pair (elapsed, MemorySampler::GetPeakMemoryMb ())));
+    NS_LOG_UNCOND ("Setup stage " << stage << " took " << elapsed << " s, peak memory " << MemorySampler::GetPeakMemoryMb () << " MB");
+    stageStart = now;
+  };
+
+  RngSeedManager::SetSeed (seedSet);
+  RngSeedManager::SetRun (runSet);
+
+  Config::SetDefault ("ns3::MmWavePhyMacCommon::CenterFreq", DoubleValue (frequency));
+  Config::SetDefault ("ns3::MmWavePhyMacCommon::ChunkPerRB", UintegerValue (72 * bandwidth / 1e9));
+  Config::SetDefault ("ns3::MmWavePhyMacCommon::NumRefScPerSym", UintegerValue (864 * bandwidth / 1e9));
+
+  Config::SetDefault ("ns3::MmWaveEnbNetDevice::AntennaNum", UintegerValue (numBsAntennaElements));
+  Config::SetDefault ("ns3::MmWaveUeNetDevice::AntennaNum", UintegerValue (numUeAntennaElements));
+
+  Config::SetDefault ("ns3::MmWave3gppChannel::UpdatePeriod", TimeValue (MilliSeconds (400))); // do not update the channel during the simulation
+  Config::SetDefault ("ns3::MmWave3gppChannel::DirectBeam", BooleanValue(true)); // Set true to perform the beam in the exact direction of receiver node
+  Config::SetDefault ("ns3::AntennaArrayModel::IsotropicAntennaElements", BooleanValue(false)); // Use the 3gpp radiation model for the antenna elements
+
+  Config::SetDefault ("ns3::MmWaveHelper::ChannelModel", StringValue("ns3::MmWave3gppChannel"));
+  Config::SetDefault ("ns3::MmWaveHelper::PathlossModel", StringValue ("ns3::MmWave3gppBuildingsPropagationLossModel"));
+  Config::SetDefault ("ns3::MmWave3gppPropagationLossModel::Scenario", StringValue ("UMa"));
+
+  Config::SetDefault ("ns3::UdpClient::PacketSize", UintegerValue (packetSize));
+  Config::SetDefault ("ns3::VideoFrameClient::PacketSize", UintegerValue (packetSize));
+  Config::SetDefault ("ns3::LteRlcAm::MaxTxBufferSize", UintegerValue (rlcBufSize * 1024 * 1024));
+  Config::SetDefault ("ns3::LteRlcUm::MaxTxBufferSize", UintegerValue (rlcBufSize * 1024 * 1024));
+  Config::SetDefault ("ns3::LteRlcAm::PollRetransmitTimer", TimeValue(MilliSeconds(1.0)));
+  Config::SetDefault ("ns3::LteRlcAm::ReorderingTimer", TimeValue(MilliSeconds(2.0)));
+  Config::SetDefault ("ns3::LteRlcAm::StatusProhibitTimer", TimeValue(MicroSeconds(500)));
+  Config::SetDefault ("ns3::LteRlcAm::ReportBufferStatusTimer", TimeValue(MicroSeconds(500)));
+  Config::SetDefault ("ns3::LteRlcUm::ReportBufferStatusTimer", TimeValue(MicroSeconds(500)));
+  Config::SetDefault ("ns3::MmWaveHelper::RlcAmEnabled", BooleanValue(rlcAm));
+
+  // Do not perform handover to lte, use always the mmwave connection.
+  // Use the LTE connection only for the traffic to control the wheelbarrow
+  // robots if wheelbarrowCtrlOnLte is set to true
+  Config::SetDefault ("ns3::LteEnbRrc::OutageThreshold", DoubleValue (-10000.0));
+
+  // split of the downlink SDUs of the multi-connectivity bearers between LTE and mmWave
+  PsSimulationConfig::SetMcSteeringPolicy (steeringPolicy, lteSplitRatio, MilliSeconds (lteMaxQueueDelay), qciSteeringTable);
+
+  // set the path where the traces will be saved, with traceWindow RlcAmBufferSize.txt is discarded unless requested
+  PsSimulationConfig::SetTracesPath (filePath, traceWindow == 0 || traceDetailLayers.find ("buffer") != std::string::npos);
+
+  // the nodes of zone z are stored in position z of each container, the UEs
+  // of a zone are its first responders followed by its wheelbarrow robot
+  NodeContainer lteBsNodes;
+  lteBsNodes.Create (numZones);
+  std::vector<NodeContainer> mmWaveBsNodes (numZones);
+  std::vector<NodeContainer> firstRespondersNodes (numZones);
+  NodeContainer wheelbarrowRobotNodes;
+  wheelbarrowRobotNodes.Create (numZones);
+  NodeContainer allMmWaveBsNodes;
+  NodeContainer allUeNodes;
+  for (uint32_t zone = 0; zone < numZones; ++zone)
+  {
+    mmWaveBsNodes[zone].Create (numOfMmWaveBsPerZone);
+    firstRespondersNodes[zone].Create (numFirstRespondersPerZone);
+    allMmWaveBsNodes.Add (mmWaveBsNodes[zone]);
+    allUeNodes.Add (firstRespondersNodes[zone]);
+    allUeNodes.Add (wheelbarrowRobotNodes.Get (zone));
+  }
+
+  // create the buildings over the whole plant
+  RandomBuildings::CreateRandomBuildingsFreeRectangles (2.0,                                  // street width between buildings
+                                                        minBuildingSize,                      // min building side
+                                                        maxBuildingSize,                      // max building size
+                                                        numZonesX * zoneSide,                 // x-side of the deployment area
+                                                        numZonesY * zoneSide,                 // y-side of the deployment area
+                                                        numZones * numOfBuildingsPerZone);    // number of buldings
+
+  for (uint32_t zone = 0; zone < numZones; ++zone)
+  {
+    double xMin = (zone % numZonesX) * zoneSide;
+    double yMin = (zone / numZonesX) * zoneSide;
+    Vector incidentCenter (xMin + zoneSide / 2, yMin + zoneSide / 2, 0);
+
+    // drop the LTE anchor of the zone at the center of the incident area
+    PsSimulationConfig::SetConstantPositionMobility (lteBsNodes.Get (zone), Vector (incidentCenter.x, incidentCenter.y, lteBsHeight));
+
+    // drop the mmWave base stations of the zone, outdoor and outside the
+    // incident area with a constraint on the minimum inter site distance
+    PsSimulationConfig::DropMmWavePoissonDiskUnits (mmWaveBsNodes[zone],
+                                                    Rectangle (xMin, xMin + zoneSide, yMin, yMin + zoneSide),
+                                                    mmWaveBsHeight,
+                                                    incidentCenter,
+                                                    incidentAreaRadius,
+                                                    minInterSiteDistance);
+
+    // drop the first responders in the zone
+    PsSimulationConfig::DropFirstResponders (xMin,
+                                             xMin + zoneSide,
+                                             yMin,
+                                             yMin + zoneSide,
+                                             ueAntennaHeight,
+                                             ueAntennaHeight,
+                                             firstRespondersNodes[zone]);
+
+    // drop the wheelbarrow robot inside the incident area of the zone
+    PsSimulationConfig::DropWheelbarrowRobot (incidentCenter.x - incidentAreaRadius,
+                                              incidentCenter.x + incidentAreaRadius,
+                                              incidentCenter.y - incidentAreaRadius,
+                                              incidentCenter.y + incidentAreaRadius,
+                                              ueAntennaHeight,
+                                              ueAntennaHeight,
+                                              wheelbarrowRobotNodes.Get (zone));
+  }
+
+  BuildingsHelper::MakeMobilityModelConsistent ();
+  endStage ("layout");
+
+  // Create the helpers
+  Ptr<MmWaveHelper> mmWaveHelper = CreateObject<MmWaveHelper> ();
+  Ptr<MmWavePointToPointEpcHelper> epcHelper = CreateObject<MmWavePointToPointEpcHelper> ();
+  mmWaveHelper->SetEpcHelper (epcHelper);
+
+  // Create the internet
+  std::pair<Ptr<Node>, Ipv4Address> remoteHostPair;
+  remoteHostPair = PsSimulationConfig::CreateInternet (epcHelper);
+
+  // Install the devices
+  NetDeviceContainer lteBsDevices = mmWaveHelper->InstallLteEnbDevice (lteBsNodes);
+  NetDeviceContainer allMmWaveBsDevices = mmWaveHelper->InstallEnbDevice (allMmWaveBsNodes);
+  NetDeviceContainer allUeDevices = mmWaveHelper->InstallMcUeDevice (allUeNodes);
+  endStage ("devices");
+
+  // Install the IP stack on the UEs
+  Ipv4InterfaceContainer ueIpIface = PsSimulationConfig::InstallUeInternet (epcHelper, allUeNodes, allUeDevices);
+  endStage ("internet");
+
+  // Connect the bs and attach the UEs zone by zone: the X2 interfaces are only
+  // created among the bs of the same zone, and each UE is only compared with
+  // the bs of its zone
+  for (uint32_t zone = 0; zone < numZones; ++zone)
+  {
+    mmWaveHelper->AddX2Interface (NodeContainer (lteBsNodes.Get (zone)), mmWaveBsNodes[zone]);
+  }
+  endStage ("x2");
+
+  for (uint32_t zone = 0; zone < numZones; ++zone)
+  {
+    NetDeviceContainer zoneMmWaveBsDevices;
+    for (uint32_t i = 0; i < numOfMmWaveBsPerZone; ++i)
+    {
+      zoneMmWaveBsDevices.Add (allMmWaveBsDevices.Get (zone * numOfMmWaveBsPerZone + i));
+    }
+    NetDeviceContainer zoneUeDevices;
+    for (uint32_t i = 0; i < numUesPerZone; ++i)
+    {
+      zoneUeDevices.Add (allUeDevices.Get (zone * numUesPerZone + i));
+    }
+    mmWaveHelper->AttachToClosestEnb (zoneUeDevices, zoneMmWaveBsDevices, NetDeviceContainer (lteBsDevices.Get (zone)));
+  }
+  endStage ("attach");
+
+  // the applications are the same of the chemical plant scenario, replicated
+  // in each zone
+  AsciiTraceHelper asciiTraceHelper;
+  Ptr<FlowStatsCollector> flowStatsCollector; // per-flow statistics of all the flows
+  Ptr<OutputStreamWrapper> frUlStream; // trace file for the UL traffic of the first responders
+  Ptr<OutputStreamWrapper> frDlStream; // trace file for the DL traffic of the first responders
+  Ptr<OutputStreamWrapper> wbUlStream; // trace file for the UL traffic of the wheelbarrow robots
+  Ptr<OutputStreamWrapper> wbDlStream; // trace file for the DL traffic of the wheelbarrow robots
+  if (flowStats)
+  {
+    flowStatsCollector = Create<FlowStatsCollector> (filePath + "flow-stats.txt", MilliSeconds (flowStatsInterval));
+    WarmStart::AddOutput (flowStatsCollector, "flow-stats.txt");
+  }
+  else
+  {
+    frUlStream = asciiTraceHelper.CreateFileStream (filePath + "fr-ul-video-stream.txt");
+    frDlStream = asciiTraceHelper.CreateFileStream (filePath + "fr-dl-video-stream.txt");
+    wbUlStream = asciiTraceHelper.CreateFileStream (filePath + "wb-ul-video-stream.txt");
+    wbDlStream = asciiTraceHelper.CreateFileStream (filePath + "wb-ctrl-traffic.txt");
+    WarmStart::AddOutput (frUlStream, "fr-ul-video-stream.txt");
+    WarmStart::AddOutput (frDlStream, "fr-dl-video-stream.txt");
+    WarmStart::AddOutput (wbUlStream, "wb-ul-video-stream.txt");
+    WarmStart::AddOutput (wbDlStream, "wb-ctrl-traffic.txt");
+  }
+  auto setupFlow = [&] (Ptr<Node> source, Ptr<Node> sink, Ipv4Address sinkAddress, uint16_t port, double rate, double start,
+                        Ptr<OutputStreamWrapper> stream, std::string flowName, bool video)
+  {
+    PsSimulationConfig::SetVideoFrameSource (videoFrames && video);
+    if (flowStatsCollector)
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (source, sink, sinkAddress, port, MicroSeconds (packetSize * 8 / rate * 1e6),
+                                              MilliSeconds (start), MilliSeconds (simTime - 100), flowStatsCollector, flowName);
+    }
+    else
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (source, sink, sinkAddress, port, MicroSeconds (packetSize * 8 / rate * 1e6),
+                                              MilliSeconds (start), MilliSeconds (simTime - 100), stream);
+    }
+  };
+
+  // crate a random variable to randomize the application start times of the
+  // first responders
+  Ptr<UniformRandomVariable> rv = CreateObject<UniformRandomVariable> ();
+  rv->SetAttribute ("Min", DoubleValue (0));
+  rv->SetAttribute ("Max", DoubleValue (600));
+  uint16_t ulPort = 1235; // port on the remote host to which the UL traffic is delivered
+  uint16_t dlPort = 1235; // port on the UEs to which the DL video is delivered
+  uint16_t wbDlCtrlPort = 1234; // port on the wheelbarrow robots to which the control traffic is delivered
+  for (uint32_t zone = 0; zone < numZones; ++zone)
+  {
+    std::ostringstream zoneName;
+    zoneName << "-z" << zone;
+    for (uint32_t frIndex = 0; frIndex < numFirstRespondersPerZone; ++frIndex)
+    {
+      // each first responder streams an uplink video feed
+      setupFlow (firstRespondersNodes[zone].Get (frIndex), remoteHostPair.first, remoteHostPair.second, ulPort++,
+                 firstRespondersVideoRate, firstRespondersAppStart + rv->GetValue (), frUlStream, "fr-ul-video" + zoneName.str (), true);
+    }
+    for (uint32_t frIndex = 0; frIndex < std::floor (numFirstRespondersPerZone * ratioDlFlows); ++frIndex)
+    {
+      // some first responders watch a downlink video feed
+      setupFlow (remoteHostPair.first, firstRespondersNodes[zone].Get (frIndex), ueIpIface.GetAddress (zone * numUesPerZone + frIndex), dlPort,
+                 firstRespondersVideoRate, firstRespondersAppStart + rv->GetValue (), frDlStream, "fr-dl-video" + zoneName.str (), true);
+    }
+
+    // the wheelbarrow robot streams an uplink video feed to the incident command
+    setupFlow (wheelbarrowRobotNodes.Get (zone), remoteHostPair.first, remoteHostPair.second, ulPort++,
+               wheelbarrowVideoRate, wheelbarrowAppStart, wbUlStream, "wb-ul-video" + zoneName.str (), true);
+
+    // the incident command remotely controls the wheelbarrow robot
+    uint32_t wbIndex = zone * numUesPerZone + numFirstRespondersPerZone;
+    setupFlow (remoteHostPair.first, wheelbarrowRobotNodes.Get (zone), ueIpIface.GetAddress (wbIndex), wbDlCtrlPort,
+               wheelbarrowCtrlRate, wheelbarrowAppStart, wbDlStream, "wb-ctrl" + zoneName.str (), false);
+    if (wheelbarrowCtrlOnLte)
+    {
+      // dedicated high-priority bearer, always sent through LTE
+      PsSimulationConfig::SetupDedicatedBearer (allUeDevices.Get (wbIndex), wbDlCtrlPort, epcHelper, EpsBearer::NGBR_MC_DELAY_SENSI_SIG);
+    }
+  }
+  endStage ("applications");
+
+  if (rlcTxBudget > 0)
+  {
+    NetDeviceContainer bearerDevices (allUeDevices);
+    for (uint32_t zone = 0; wheelbarrowCtrlOnLte && zone < numZones; ++zone)
+    {
+      bearerDevices.Add (allUeDevices.Get (zone * numUesPerZone + numFirstRespondersPerZone)); // dedicated bearer of the wheelbarrow robot
+    }
+    PsSimulationConfig::SetRlcTxBufferCap (rlcTxBudget, bearerDevices);
+  }
+
+  // one line per window and user instead of one per PDU or transport block
+  Ptr<WindowedTraceAggregator> traceAggregator;
+  if (traceWindow > 0)
+  {
+    traceAggregator = Create<WindowedTraceAggregator> (filePath, MilliSeconds (traceWindow), traceDetailLayers, traceDetailRntis);
+    if (traceBufferInterval > 0)
+    {
+      traceAggregator->EnableBufferSampling (MilliSeconds (traceBufferInterval));
+    }
+    WarmStart::AddOutput (traceAggregator, "");
+  }
+  else if (enableTraces)
+  {
+    mmWaveHelper->EnableTraces ();
+  }
+
+  PrintHelper::PrintGnuplottableBuildingListToFile (filePath + "obstacles.txt");
+  PrintHelper::PrintGnuplottableNodeListToFile (filePath + "nodes.txt");
+
+  // the positions of the nodes are sampled in a single event every mobilityInterval,
+  // scripts/convert_mobility_trace.pl converts them to the gnuplot labels of nodes.txt
+  Ptr<MobilitySnapshotWriter> mobilityWriter;
+  if (mobilityInterval > 0)
+  {
+    NS_ABORT_MSG_IF (mobilityNodes != "ues" && mobilityNodes != "all", "Unknown mobilityNodes " << mobilityNodes);
+    NodeContainer sampledNodes = (mobilityNodes == "all") ? NodeContainer::GetGlobal () : PrintHelper::GetUeNodes ();
+    mobilityWriter = Create<MobilitySnapshotWriter> (filePath + "mobility.bin", sampledNodes, MilliSeconds (mobilityInterval));
+    WarmStart::AddOutput (mobilityWriter, "mobility.bin");
+  }
+
+  // the simulation stops at the end of the first batch in which the KPIs
+  // of all the sinks have converged, or at the usual stop time otherwise
+  Ptr<ConvergenceMonitor> convergenceMonitor;
+  if (convergencePrecision > 0)
+  {
+    convergenceMonitor = Create<ConvergenceMonitor> (convergenceMetrics, MilliSeconds (convergenceBatch),
+                                                     convergencePrecision, MilliSeconds (convergenceMinTime));
+  }
+
+  // the memory of the process over the simulation time, to size the runs
+  Ptr<MemorySampler> memorySampler;
+  if (memoryInterval > 0)
+  {
+    memorySampler = Create<MemorySampler> (filePath + "memory.txt", MilliSeconds (memoryInterval));
+    WarmStart::AddOutput (memorySampler, "memory.txt");
+  }
+
+  // the UEs which are not connected to their closest BS
+  Ptr<AssociationMonitor> associationMonitor;
+  if (associationInterval > 0)
+  {
+    associationMonitor = Create<AssociationMonitor> (filePath + "association.txt", MilliSeconds (associationInterval),
+                                                     allUeDevices, allMmWaveBsDevices);
+    WarmStart::AddOutput (associationMonitor, "association.txt");
+  }
+
+  double setupTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - setupStart).count ();
+  NS_LOG_UNCOND ("Setup of " << numZones << " zones, " << allUeNodes.GetN () << " UEs and "
+                 << allMmWaveBsNodes.GetN () << " mmWave BSs took " << setupTime << " s");
+
+  Simulator::Stop(MilliSeconds (simTime));
+  std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now ();
+  Simulator::Run();
+  double runTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - runStart).count ();
+
+  if (convergenceMonitor)
+  {
+    convergenceMonitor->Report ();
+  }
+
+  if (memorySampler)
+  {
+    memorySampler->Close ();
+  }
+
+  if (associationMonitor)
+  {
+    associationMonitor->Report ();
+    associationMonitor->Close ();
+  }
+
+  if (traceAggregator)
+  {
+    traceAggregator->Close ();
+  }
+
+  if (mobilityWriter)
+  {
+    mobilityWriter->Close ();
+  }
+
+  if (flowStatsCollector)
+  {
+    flowStatsCollector->Dump ();
+  }
+
+  double speed = runTime > 0 ? simTime / 1e3 / runTime : 0;
+  NS_LOG_UNCOND ("Simulated " << simTime / 1e3 << " s in " << runTime << " s (" << speed
+                 << " simulated seconds per wall-clock second), peak memory " << MemorySampler::GetPeakMemoryMb () << " MB");
+
+  if (forkRuns > 0)
+  {
+    filePath = WarmStart::GetFilePath (); // folder of this forked run
+  }
+  std::ofstream stats ((filePath + "scale-out-stats.txt").c_str ());
+  stats << "zones\t" << numZones << std::endl
+        << "ues\t" << allUeNodes.GetN () << std::endl
+        << "mmWaveBs\t" << allMmWaveBsNodes.GetN () << std::endl
+        << "buildings\t" << BuildingList::GetNBuildings () << std::endl;
+  for (uint32_t i = 0; i < setupStages.size (); ++i)
+  {
+    stats << "setup-" << setupStages[i].first << "[s]\t" << setupStages[i].second.first << std::endl
+          << "setup-" << setupStages[i].first << "-peakMemory[MB]\t" << setupStages[i].second.second << std::endl;
+  }
+  stats << "setup[s]\t" << setupTime << std::endl
+        << "run[s]\t" << runTime << std::endl
+        << "simulatedSecondsPerWallSecond\t" << speed << std::endl
+        << "peakMemory[MB]\t" << MemorySampler::GetPeakMemoryMb () << std::endl;
+  stats.close ();
+
+  if (steeringStats)
+  {
+    // the share of each leg and the reordering caused by the split, per bearer
+    PsSimulationConfig::WriteMcSteeringStats (filePath + "steering-stats.txt");
+  }
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -43,6 +43,25 @@ main (int argc, char *argv[])
   double wheelbarrowCtrlRate = 50e3; // data rate of the application which controls the wheelbarrow robot [bit/s]
   bool wheelbarrowCtrlOnLte = true; // if true, send the traffic to control the wheelbarrow robot through LTE
   double packetSize = 1024; // packet size [bytes]
+  bool flowStats = false; // if true, collect per-flow delay, jitter and loss statistics instead of the application traces
+  uint32_t flowStatsInterval = 0; // interval between two dumps of the flow statistics in milliseconds, if 0 dump only at the end
+  bool profileEvents = false; // if true, profile the wall time of the scheduled events
+  uint32_t profileBin = 100; // width of the bins of the event timeline in milliseconds
+  bool videoFrames = false; // if true, the video feeds send whole frames at the frame rate instead of constant bit rate packets
+  uint32_t mobilityInterval = 1000; // interval between two samples of the node positions in milliseconds, if 0 the positions are not sampled
+  std::string mobilityNodes = "ues"; // nodes whose positions are sampled, "ues" or "all"
+  uint32_t forkRuns = 0; // number of runs forked at the warm start checkpoint, if 0 the warm start is disabled
+  uint32_t forkAt = 400; // time of the warm start checkpoint in milliseconds, after the network attach
+  double convergencePrecision = 0; // relative half-width of the 95% confidence intervals of the KPIs at which the run stops, if 0 the run is not stopped early
+  std::string convergenceMetrics = "throughput,delay"; // KPIs of the early stop, comma-separated list of throughput and delay
+  uint32_t convergenceBatch = 100; // length of the batches of the early stop in milliseconds
+  uint32_t convergenceMinTime = 0; // minimum simulation time in milliseconds before an early stop
+  uint32_t memoryInterval = 0; // interval between two samples of the memory of the process in milliseconds, if 0 the memory is not sampled
+  uint32_t associationInterval = 0; // interval between two checks of the closest BS of each UE in milliseconds, if 0 the association is not checked
+  uint32_t traceWindow = 0; // window of the aggregated PHY, RLC and PDCP traces in milliseconds, if 0 the full traces are written
+  std::string traceDetailLayers = ""; // layers whose received PDUs are still written in full with traceWindow, comma-separated list of phy, rlc, pdcp and buffer
+  std::string traceDetailRntis = ""; // RNTIs whose PDUs are written in full for traceDetailLayers, comma-separated, if empty all the RNTIs
+  uint32_t traceBufferInterval = 0; // interval between two samples of the RLC buffers with traceWindow in milliseconds, if 0 the buffers are not sampled
 
   // LAYOUT
   double incidentAreaRadius = 200.0; // radius of the incident area in meters
@@ -50,6 +69,8 @@ main (int argc, char *argv[])
   double minBuildingSize = 50.0; // minimum dimension of a building in meters
   double maxBuildingSize = 300.0; // maximum dimension of a building in meters
   uint32_t numOfBuildings = 10; // number of buildings
+  std::string layoutCache = ""; // folder of the layout snapshots, if empty the layout is generated in every run
+  bool scalableLayout = false; // if true, place the buildings with free-rectangle tracking and the mmwave bs with Poisson-disk sampling
 
   uint32_t numOfMmWaveBs = 5; // number of mmwave base stations
   double minInterSiteDistance = 60.0; // minimum intersite distance between the bs
@@ -68,6 +89,14 @@ main (int argc, char *argv[])
   // RLC PARAMETERS
   bool rlcAm = true; // if true use RLC AM, if false use RLC UM
   uint32_t rlcBufSize = 10; // RLC buffer size
+  double rlcTxBudget = 0; // MB divided evenly into the cap of the transmission buffer of each RLC entity, if 0 each buffer has rlcBufSize MB
+
+  // MULTI-CONNECTIVITY PARAMETERS
+  std::string steeringPolicy = "qci-threshold"; // policy which splits the downlink SDUs between LTE and mmWave, qci-threshold, fixed-split or queue-delay
+  double lteSplitRatio = 0.5; // share of the downlink bytes sent on LTE with the fixed-split policy
+  uint32_t lteMaxQueueDelay = 10; // maximum queueing delay in the LTE RLC buffer with the queue-delay policy in milliseconds
+  std::string qciSteeringTable = ""; // comma-separated list of qci:lteShare, the bearers with these QCIs use a fixed split with their share
+  bool steeringStats = false; // if true, write the per-bearer steering statistics to steering-stats.txt
 
   CommandLine cmd;
   cmd.AddValue ("filePath", "path for the output files", filePath);
@@ -81,6 +110,25 @@ main (int argc, char *argv[])
   cmd.AddValue ("wheelbarrowCtrlRate", "data rate of the application which controls the wheelbarrow robot [bit/s]", wheelbarrowCtrlRate);
   cmd.AddValue ("wheelbarrowCtrlOnLte", "if true, send the traffic to control the wheelbarrow robot through LTE", wheelbarrowCtrlOnLte);
   cmd.AddValue ("packetSize", "packet size [bytes]", packetSize);
+  cmd.AddValue ("flowStats", "if true, collect per-flow delay, jitter and loss statistics instead of the application traces", flowStats);
+  cmd.AddValue ("flowStatsInterval", "interval between two dumps of the flow statistics in milliseconds, if 0 dump only at the end", flowStatsInterval);
+  cmd.AddValue ("profileEvents", "if true, profile the wall time of the scheduled events", profileEvents);
+  cmd.AddValue ("profileBin", "width of the bins of the event timeline in milliseconds", profileBin);
+  cmd.AddValue ("videoFrames", "if true, the video feeds send whole frames at the frame rate instead of constant bit rate packets", videoFrames);
+  cmd.AddValue ("mobilityInterval", "interval between two samples of the node positions in milliseconds, if 0 the positions are not sampled", mobilityInterval);
+  cmd.AddValue ("mobilityNodes", "nodes whose positions are sampled, ues or all", mobilityNodes);
+  cmd.AddValue ("forkRuns", "number of runs forked at the warm start checkpoint, if 0 the warm start is disabled", forkRuns);
+  cmd.AddValue ("forkAt", "time of the warm start checkpoint in milliseconds, after the network attach", forkAt);
+  cmd.AddValue ("convergencePrecision", "relative half-width of the 95% confidence intervals of the KPIs at which the run stops, if 0 the run is not stopped early", convergencePrecision);
+  cmd.AddValue ("convergenceMetrics", "KPIs of the early stop, comma-separated list of throughput and delay", convergenceMetrics);
+  cmd.AddValue ("convergenceBatch", "length of the batches of the early stop in milliseconds", convergenceBatch);
+  cmd.AddValue ("convergenceMinTime", "minimum simulation time in milliseconds before an early stop", convergenceMinTime);
+  cmd.AddValue ("memoryInterval", "interval between two samples of the memory of the process in milliseconds, if 0 the memory is not sampled", memoryInterval);
+  cmd.AddValue ("associationInterval", "interval between two checks of the closest BS of each UE in milliseconds, if 0 the association is not checked", associationInterval);
+  cmd.AddValue ("traceWindow", "window of the aggregated PHY, RLC and PDCP traces in milliseconds, if 0 the full traces are written", traceWindow);
+  cmd.AddValue ("traceDetailLayers", "layers whose received PDUs are still written in full with traceWindow, comma-separated list of phy, rlc, pdcp and buffer", traceDetailLayers);
+  cmd.AddValue ("traceDetailRntis", "RNTIs whose PDUs are written in full for traceDetailLayers, comma-separated, if empty all the RNTIs", traceDetailRntis);
+  cmd.AddValue ("traceBufferInterval", "interval between two samples of the RLC buffers with traceWindow in milliseconds, if 0 the buffers are not sampled", traceBufferInterval);
   cmd.AddValue ("incidentAreaRadius", "radius of the incident area in meters", incidentAreaRadius);
   cmd.AddValue ("plantSide", "dimension of the chemical plant in meters", plantSide);
   cmd.AddValue ("minBuildingSize", "minimum dimension of a building in meters", minBuildingSize);
@@ -90,16 +138,42 @@ main (int argc, char *argv[])
   cmd.AddValue ("lteBsHeight", "height of the lte base stations", lteBsHeight);
   cmd.AddValue ("minInterSiteDistance", "minimum intersite distance between the bs", minInterSiteDistance);
   cmd.AddValue ("numFirstResponders", "number of first responders", numFirstResponders);
+  cmd.AddValue ("layoutCache", "folder of the layout snapshots, if empty the layout is generated in every run", layoutCache);
+  cmd.AddValue ("scalableLayout", "if true, place the buildings with free-rectangle tracking and the mmwave bs with Poisson-disk sampling", scalableLayout);
   cmd.AddValue ("ueAntennaHeight", "UE antenna height", ueAntennaHeight);
   cmd.AddValue ("ratioDlFlows", "ratio between UL and DL flows", ratioDlFlows);
   cmd.AddValue ("numBsAntennaElements", "number of BS antenna elements", numBsAntennaElements);
   cmd.AddValue ("numUeAntennaElements", "number of UE antenna elements", numUeAntennaElements);
   cmd.AddValue ("rlcAm", "if true use RLC AM, if false use RLC UM", rlcAm);
   cmd.AddValue ("rlcBufSize", "RLC buffer size", rlcBufSize);
+  cmd.AddValue ("rlcTxBudget", "MB divided evenly into the cap of the transmission buffer of each RLC entity, if 0 each buffer has rlcBufSize MB", rlcTxBudget);
+  cmd.AddValue ("steeringPolicy", "policy which splits the downlink SDUs between LTE and mmWave, qci-threshold, fixed-split or queue-delay", steeringPolicy);
+  cmd.AddValue ("lteSplitRatio", "share of the downlink bytes sent on LTE with the fixed-split policy", lteSplitRatio);
+  cmd.AddValue ("lteMaxQueueDelay", "maximum queueing delay in the LTE RLC buffer with the queue-delay policy in milliseconds", lteMaxQueueDelay);
+  cmd.AddValue ("qciSteeringTable", "comma-separated list of qci:lteShare, the bearers with these QCIs use a fixed split with their share", qciSteeringTable);
+  cmd.AddValue ("steeringStats", "if true, write the per-bearer steering statistics to steering-stats.txt", steeringStats);
   cmd.AddValue ("frequency", "operating frequency", frequency);
   cmd.AddValue ("bandwidth", "system bandwidth", bandwidth);
   cmd.Parse (argc, argv);
 
+  if (profileEvents)
+  {
+    // EventProfile.txt and EventTimeline.txt are written when Simulator::Run returns
+    PsSimulationConfig::EnableEventProfiler (filePath, MilliSeconds (profileBin));
+  }
+
+  if (forkRuns > 0)
+  {
+    // at forkAt the process forks forkRuns children with runs runSet, runSet + 1, ...,
+    // which continue the simulation and write their outputs in filePath/fork-<i>/
+    NS_ABORT_MSG_IF (profileEvents, "The event profiler can't be used with the warm start");
+    // the files of the full traces and of the RLC AM buffer are opened by the modules and can't be moved in fork-<i>/
+    NS_ABORT_MSG_IF (traceWindow == 0, "The full traces can't be used with the warm start, use traceWindow");
+    NS_ABORT_MSG_IF (traceDetailLayers.find ("buffer") != std::string::npos, "The buffer trace layer can't be used with the warm start");
+    NS_ABORT_MSG_IF (forkAt >= simTime, "The warm start checkpoint must be before the end of the simulation");
+    WarmStart::Enable (MilliSeconds (forkAt), forkRuns, filePath, runSet);
+  }
+
   RngSeedManager::SetSeed (seedSet);
   RngSeedManager::SetRun (runSet);
 
@@ -119,6 +193,8 @@ main (int argc, char *argv[])
   Config::SetDefault ("ns3::MmWave3gppPropagationLossModel::Scenario", StringValue ("UMa"));
 
   Config::SetDefault ("ns3::UdpClient::PacketSize", UintegerValue (packetSize));
+  Config::SetDefault ("ns3::VideoFrameClient::PacketSize", UintegerValue (packetSize));
+  PsSimulationConfig::SetVideoFrameSource (videoFrames);
   Config::SetDefault ("ns3::LteRlcAm::MaxTxBufferSize", UintegerValue (rlcBufSize * 1024 * 1024));
   Config::SetDefault ("ns3::LteRlcUm::MaxTxBufferSize", UintegerValue (rlcBufSize * 1024 * 1024));
   Config::SetDefault ("ns3::LteRlcAm::PollRetransmitTimer", TimeValue(MilliSeconds(1.0)));
@@ -133,6 +209,9 @@ main (int argc, char *argv[])
   // robot if wheelbarrowCtrlOnLte is set to true
   Config::SetDefault ("ns3::LteEnbRrc::OutageThreshold", DoubleValue (-10000.0));
 
+  // split of the downlink SDUs of the multi-connectivity bearers between LTE and mmWave
+  PsSimulationConfig::SetMcSteeringPolicy (steeringPolicy, lteSplitRatio, MilliSeconds (lteMaxQueueDelay), qciSteeringTable);
+
   NodeContainer lteBsNode;
   lteBsNode.Create (1);
 
@@ -145,27 +224,75 @@ main (int argc, char *argv[])
   NodeContainer wheelbarrowRobotNode;
   wheelbarrowRobotNode.Create (1);
 
-  // create the buildings
-  RandomBuildings::CreateRandomBuildings (2.0,              // street width between buildings
-                                          minBuildingSize,  // min building side
-                                          maxBuildingSize,  // max building size
-                                          plantSide,        // x-side of the deployment area
-                                          plantSide,        // y-side of the deployment area
-                                          numOfBuildings);  // number of buldings
-
-  //drop the LTE macro
-  PsSimulationConfig::SetConstantPositionMobility (lteBsNode, Vector (0.0, 0.0, lteBsHeight));
-
-  // drop the mmaWave base stations
-  // random deployment outdoor and outside the incident area with a constraint
-  // on the minimum inter site distance
-  PsSimulationConfig::DropMmWaveRandomUnits (mmWaveBsNodes,            // nodes
-                                           plantSide,          // xMax
-                                           plantSide,          // yMax
-                                           mmWaveBsHeight,           // site height
-                                           incidentAreaRadius,  // forbidden radius
-                                           minInterSiteDistance); // minimum intersite distance between the bs
-                                           PsSimulationConfig::SetTracesPath (filePath); // set the path where the traces will be saved
+  // load the buildings and the node positions from a previous run with the
+  // same seed, run and layout parameters, if available
+  Ptr<LayoutSnapshot> layoutSnapshot;
+  bool layoutFromSnapshot = false;
+  if (!layoutCache.empty ())
+  {
+    std::ostringstream layoutKey;
+    layoutKey.precision (17);
+    layoutKey << "chemical-plant-scenario"
+              << " seedSet=" << seedSet << " runSet=" << runSet
+              << " plantSide=" << plantSide << " incidentAreaRadius=" << incidentAreaRadius
+              << " minBuildingSize=" << minBuildingSize << " maxBuildingSize=" << maxBuildingSize
+              << " numOfBuildings=" << numOfBuildings << " numOfMmWaveBs=" << numOfMmWaveBs
+              << " minInterSiteDistance=" << minInterSiteDistance << " mmWaveBsHeight=" << mmWaveBsHeight
+              << " lteBsHeight=" << lteBsHeight << " numFirstResponders=" << numFirstResponders
+              << " ueAntennaHeight=" << ueAntennaHeight << " scalableLayout=" << scalableLayout;
+    layoutSnapshot = Create<LayoutSnapshot> (layoutCache, layoutKey.str ());
+    layoutFromSnapshot = layoutSnapshot->Load ();
+  }
+
+  Ptr<PositionAllocator> firstRespondersPositions; // if 0, the first responders are dropped randomly
+  Ptr<PositionAllocator> wheelbarrowRobotPositions; // if 0, the wheelbarrow robot is dropped randomly
+  if (layoutFromSnapshot)
+  {
+    // the buildings have been created by the snapshot
+    layoutSnapshot->SetConstantPositionMobility (lteBsNode);
+    layoutSnapshot->SetConstantPositionMobility (mmWaveBsNodes);
+    firstRespondersPositions = layoutSnapshot->GetPositionAllocator (firstRespondersNodes);
+    wheelbarrowRobotPositions = layoutSnapshot->GetPositionAllocator (wheelbarrowRobotNode);
+  }
+  else
+  {
+    // create the buildings
+    if (scalableLayout)
+    {
+      RandomBuildings::CreateRandomBuildingsFreeRectangles (2.0, minBuildingSize, maxBuildingSize, plantSide, plantSide, numOfBuildings);
+    }
+    else
+    {
+      RandomBuildings::CreateRandomBuildings (2.0,              // street width between buildings
+                                              minBuildingSize,  // min building side
+                                              maxBuildingSize,  // max building size
+                                              plantSide,        // x-side of the deployment area
+                                              plantSide,        // y-side of the deployment area
+                                              numOfBuildings);  // number of buldings
+    }
+
+    //drop the LTE macro
+    PsSimulationConfig::SetConstantPositionMobility (lteBsNode, Vector (0.0, 0.0, lteBsHeight));
+
+    // drop the mmaWave base stations
+    // random deployment outdoor and outside the incident area with a constraint
+    // on the minimum inter site distance
+    if (scalableLayout)
+    {
+      PsSimulationConfig::DropMmWavePoissonDiskUnits (mmWaveBsNodes, plantSide, plantSide, mmWaveBsHeight, incidentAreaRadius, minInterSiteDistance);
+    }
+    else
+    {
+      PsSimulationConfig::DropMmWaveRandomUnits (mmWaveBsNodes,            // nodes
+                                               plantSide,          // xMax
+                                               plantSide,          // yMax
+                                               mmWaveBsHeight,           // site height
+                                               incidentAreaRadius,  // forbidden radius
+                                               minInterSiteDistance); // minimum intersite distance between the bs
+    }
+  }
+  // set the path where the traces will be saved, with traceWindow RlcAmBufferSize.txt is discarded unless requested
+  PsSimulationConfig::SetTracesPath (filePath, traceWindow == 0 || traceDetailLayers.find ("buffer") != std::string::npos);
 
   // drop the first responders
   PsSimulationConfig::DropFirstResponders (0,
@@ -174,7 +301,8 @@ main (int argc, char *argv[])
                                          plantSide,
                                          ueAntennaHeight,
                                          ueAntennaHeight,
-                                         firstRespondersNodes);
+                                         firstRespondersNodes,
+                                         firstRespondersPositions);
 
   // drop the wheelbarrow robot inside the incident area
   PsSimulationConfig::DropWheelbarrowRobot (plantSide / 2 - incidentAreaRadius,
@@ -183,7 +311,13 @@ main (int argc, char *argv[])
                                           plantSide / 2 + incidentAreaRadius,
                                           ueAntennaHeight,
                                           ueAntennaHeight,
-                                          wheelbarrowRobotNode);
+                                          wheelbarrowRobotNode,
+                                          wheelbarrowRobotPositions);
+
+  if (layoutSnapshot && !layoutFromSnapshot)
+  {
+    layoutSnapshot->Save ();
+  }
 
   BuildingsHelper::MakeMobilityModelConsistent ();
 
@@ -212,7 +346,18 @@ main (int argc, char *argv[])
 
   // each first responder streams an uplink video feed
   AsciiTraceHelper asciiTraceHelper;
-  Ptr<OutputStreamWrapper> ulStream = asciiTraceHelper.CreateFileStream (filePath + "fr-ul-video-stream.txt"); // trace file for UL traffic
+  Ptr<OutputStreamWrapper> ulStream; // trace file for UL traffic
+  Ptr<FlowStatsCollector> flowStatsCollector; // per-flow statistics of all the flows
+  if (flowStats)
+  {
+    flowStatsCollector = Create<FlowStatsCollector> (filePath + "flow-stats.txt", MilliSeconds (flowStatsInterval));
+    WarmStart::AddOutput (flowStatsCollector, "flow-stats.txt");
+  }
+  else
+  {
+    ulStream = asciiTraceHelper.CreateFileStream (filePath + "fr-ul-video-stream.txt");
+    WarmStart::AddOutput (ulStream, "fr-ul-video-stream.txt");
+  }
   uint16_t ulPort = 1235; // port on the remote host to which the UL traffic is delivered
   // crate a random variable to randomize the application start times of the
   // first responders
@@ -221,41 +366,97 @@ main (int argc, char *argv[])
   rv->SetAttribute ("Max", DoubleValue (600));
   for (uint32_t frIndex = 0; frIndex < firstRespondersNodes.GetN (); ++frIndex)
   {
-    PsSimulationConfig::SetupUplinkUdpFlow (
-      firstRespondersNodes.Get(frIndex), // source
-      remoteHostPair.first, // sink
-      remoteHostPair.second, // sink address
-      ulPort++, // port
-      MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
-      MilliSeconds (firstRespondersAppStart + rv->GetValue ()), // start time of the application [ms]
-      MilliSeconds (simTime - 100), // end time of the application [ms]
-      ulStream // trace
-    );
+    if (flowStats)
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        firstRespondersNodes.Get(frIndex), // source
+        remoteHostPair.first, // sink
+        remoteHostPair.second, // sink address
+        ulPort++, // port
+        MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (firstRespondersAppStart + rv->GetValue ()), // start time of the application [ms]
+        MilliSeconds (simTime - 100), // end time of the application [ms]
+        flowStatsCollector, // flow statistics
+        "fr-ul-video" // name of the flow
+      );
+    }
+    else
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        firstRespondersNodes.Get(frIndex), // source
+        remoteHostPair.first, // sink
+        remoteHostPair.second, // sink address
+        ulPort++, // port
+        MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (firstRespondersAppStart + rv->GetValue ()), // start time of the application [ms]
+        MilliSeconds (simTime - 100), // end time of the application [ms]
+        ulStream // trace
+      );
+    }
   }
 
   // some first responders watches a downlink video feed
-  Ptr<OutputStreamWrapper> dlStream = asciiTraceHelper.CreateFileStream (filePath + "fr-dl-video-stream.txt"); // trace file for DL traffic
+  Ptr<OutputStreamWrapper> dlStream; // trace file for DL traffic
+  if (!flowStats)
+  {
+    dlStream = asciiTraceHelper.CreateFileStream (filePath + "fr-dl-video-stream.txt");
+    WarmStart::AddOutput (dlStream, "fr-dl-video-stream.txt");
+  }
   uint16_t dlPort = ulPort + numFirstResponders + 1; // port on the UE to which the DL traffic is delivered
   for (uint32_t frIndex = 0; frIndex < std::floor(firstRespondersNodes.GetN () * ratioDlFlows); ++frIndex)
   {
-    PsSimulationConfig::SetupUplinkUdpFlow (
-      remoteHostPair.first, // source
-      firstRespondersNodes.Get(frIndex), // sink
-      ueIpIface.GetAddress(frIndex), // sink address
-      dlPort++, // port
-      MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
-      MilliSeconds (firstRespondersAppStart + rv->GetValue ()), // start time of the application [ms]
-      MilliSeconds (simTime - 100), // end time of the application [ms]
-      dlStream // trace
-    );
+    if (flowStats)
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        remoteHostPair.first, // source
+        firstRespondersNodes.Get(frIndex), // sink
+        ueIpIface.GetAddress(frIndex), // sink address
+        dlPort++, // port
+        MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (firstRespondersAppStart + rv->GetValue ()), // start time of the application [ms]
+        MilliSeconds (simTime - 100), // end time of the application [ms]
+        flowStatsCollector, // flow statistics
+        "fr-dl-video" // name of the flow
+      );
+    }
+    else
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        remoteHostPair.first, // source
+        firstRespondersNodes.Get(frIndex), // sink
+        ueIpIface.GetAddress(frIndex), // sink address
+        dlPort++, // port
+        MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (firstRespondersAppStart + rv->GetValue ()), // start time of the application [ms]
+        MilliSeconds (simTime - 100), // end time of the application [ms]
+        dlStream // trace
+      );
+    }
   }
 
   NS_LOG_DEBUG ("First responders applications interPacketInterval " << packetSize * 8 / firstRespondersVideoRate * 1e6 << " us");
 
   // the wheelbarrow robot streams an uplink video feed to the incident command
-  ulStream = asciiTraceHelper.CreateFileStream (filePath + "wb-ul-video-stream.txt"); // trace file for UL traffic
   uint16_t wbUlVideoPort = 1233;
-  PsSimulationConfig::SetupUplinkUdpFlow (
+  if (flowStats)
+  {
+    PsSimulationConfig::SetupUplinkUdpFlow (
+      wheelbarrowRobotNode.Get(0), // source
+      remoteHostPair.first, // sink
+      remoteHostPair.second, // sink address
+      wbUlVideoPort, // port
+      MicroSeconds (packetSize * 8 / wheelbarrowVideoRate * 1e6), // time interval between consecutive packets [us]
+      MilliSeconds (wheelbarrowAppStart), // start time of the application [ms]
+      MilliSeconds (simTime - 100), // end time of the application [ms]
+      flowStatsCollector, // flow statistics
+      "wb-ul-video" // name of the flow
+    );
+  }
+  else
+  {
+    ulStream = asciiTraceHelper.CreateFileStream (filePath + "wb-ul-video-stream.txt"); // trace file for UL traffic
+    WarmStart::AddOutput (ulStream, "wb-ul-video-stream.txt");
+    PsSimulationConfig::SetupUplinkUdpFlow (
       wheelbarrowRobotNode.Get(0), // source
       remoteHostPair.first, // sink
       remoteHostPair.second, // sink address
@@ -265,13 +466,32 @@ main (int argc, char *argv[])
       MilliSeconds (simTime - 100), // end time of the application [ms]
       ulStream // trace
     );
+  }
 
   NS_LOG_DEBUG ("Wheelbarrow video application interPacketInterval " << packetSize * 8 / wheelbarrowVideoRate * 1e6 << " us");
 
   // the incident command remotely controls the wheelbarrow robot
-  dlStream = asciiTraceHelper.CreateFileStream (filePath + "wb-ctrl-traffic.txt"); // trace file for DL traffic
+  PsSimulationConfig::SetVideoFrameSource (false); // the control traffic is not a video feed
   uint16_t wbDlCtrlPort = 1234;
-  PsSimulationConfig::SetupUplinkUdpFlow (
+  if (flowStats)
+  {
+    PsSimulationConfig::SetupUplinkUdpFlow (
+      remoteHostPair.first, // source
+      wheelbarrowRobotNode.Get(0), // sink
+      ueIpIface.GetAddress(numFirstResponders), // sink address
+      wbDlCtrlPort, // port
+      MicroSeconds (packetSize * 8 / wheelbarrowCtrlRate * 1e6), // time interval between consecutive packets [us]
+      MilliSeconds (wheelbarrowAppStart), // start time of the application [ms]
+      MilliSeconds (simTime - 100), // end time of the application [ms]
+      flowStatsCollector, // flow statistics
+      "wb-ctrl" // name of the flow
+    );
+  }
+  else
+  {
+    dlStream = asciiTraceHelper.CreateFileStream (filePath + "wb-ctrl-traffic.txt"); // trace file for DL traffic
+    WarmStart::AddOutput (dlStream, "wb-ctrl-traffic.txt");
+    PsSimulationConfig::SetupUplinkUdpFlow (
       remoteHostPair.first, // source
       wheelbarrowRobotNode.Get(0), // sink
       ueIpIface.GetAddress(numFirstResponders), // sink address
@@ -281,6 +501,7 @@ main (int argc, char *argv[])
       MilliSeconds (simTime - 100), // end time of the application [ms]
       dlStream // trace
     );
+  }
 
   NS_LOG_DEBUG ("Wheelbarrow contrl application interPacketInterval " << packetSize * 8 / wheelbarrowCtrlRate * 1e6 << " us");
 
@@ -293,13 +514,111 @@ main (int argc, char *argv[])
     PsSimulationConfig::SetupDedicatedBearer (wbDevice, wbDlCtrlPort, epcHelper, EpsBearer::NGBR_MC_DELAY_SENSI_SIG);
   }
 
-  mmWaveHelper->EnableTraces ();
+  if (rlcTxBudget > 0)
+  {
+    NetDeviceContainer bearerDevices (ueDevices);
+    if (wheelbarrowCtrlOnLte)
+    {
+      bearerDevices.Add (ueDevices.Get (numFirstResponders)); // dedicated bearer of the wheelbarrow robot
+    }
+    PsSimulationConfig::SetRlcTxBufferCap (rlcTxBudget, bearerDevices);
+  }
+
+  // one line per window and user instead of one per PDU or transport block
+  Ptr<WindowedTraceAggregator> traceAggregator;
+  if (traceWindow > 0)
+  {
+    traceAggregator = Create<WindowedTraceAggregator> (filePath, MilliSeconds (traceWindow), traceDetailLayers, traceDetailRntis);
+    if (traceBufferInterval > 0)
+    {
+      traceAggregator->EnableBufferSampling (MilliSeconds (traceBufferInterval));
+    }
+    WarmStart::AddOutput (traceAggregator, "");
+  }
+  else
+  {
+    mmWaveHelper->EnableTraces ();
+  }
 
-  PrintHelper::PrintGnuplottableBuildingListToFile ("obstacles.txt");
-  PrintHelper::PrintGnuplottableNodeListToFile ("nodes.txt");
+  PrintHelper::PrintGnuplottableBuildingListToFile (filePath + "obstacles.txt");
+  PrintHelper::PrintGnuplottableNodeListToFile (filePath + "nodes.txt");
+
+  // the positions of the nodes are sampled in a single event every mobilityInterval,
+  // scripts/convert_mobility_trace.pl converts them to the gnuplot labels of nodes.txt
+  Ptr<MobilitySnapshotWriter> mobilityWriter;
+  if (mobilityInterval > 0)
+  {
+    NS_ABORT_MSG_IF (mobilityNodes != "ues" && mobilityNodes != "all", "Unknown mobilityNodes " << mobilityNodes);
+    NodeContainer sampledNodes = (mobilityNodes == "all") ? NodeContainer::GetGlobal () : PrintHelper::GetUeNodes ();
+    mobilityWriter = Create<MobilitySnapshotWriter> (filePath + "mobility.bin", sampledNodes, MilliSeconds (mobilityInterval));
+    WarmStart::AddOutput (mobilityWriter, "mobility.bin");
+  }
+
+  // the simulation stops at the end of the first batch in which the KPIs
+  // of all the sinks have converged, or at the usual stop time otherwise
+  Ptr<ConvergenceMonitor> convergenceMonitor;
+  if (convergencePrecision > 0)
+  {
+    convergenceMonitor = Create<ConvergenceMonitor> (convergenceMetrics, MilliSeconds (convergenceBatch),
+                                                     convergencePrecision, MilliSeconds (convergenceMinTime));
+  }
+
+  // the memory of the process over the simulation time, to size the runs
+  Ptr<MemorySampler> memorySampler;
+  if (memoryInterval > 0)
+  {
+    memorySampler = Create<MemorySampler> (filePath + "memory.txt", MilliSeconds (memoryInterval));
+    WarmStart::AddOutput (memorySampler, "memory.txt");
+  }
+
+  // the UEs which are not connected to their closest BS
+  Ptr<AssociationMonitor> associationMonitor;
+  if (associationInterval > 0)
+  {
+    associationMonitor = Create<AssociationMonitor> (filePath + "association.txt", MilliSeconds (associationInterval),
+                                                     ueDevices, mmWaveBsDevices);
+    WarmStart::AddOutput (associationMonitor, "association.txt");
+  }
 
   Simulator::Stop(MilliSeconds (simTime));
   Simulator::Run();
 
+  if (convergenceMonitor)
+  {
+    convergenceMonitor->Report ();
+  }
+
+  if (memorySampler)
+  {
+    memorySampler->Close ();
+  }
+
+  if (associationMonitor)
+  {
+    associationMonitor->Report ();
+    associationMonitor->Close ();
+  }
+
+  if (traceAggregator)
+  {
+    traceAggregator->Close ();
+  }
+
+  if (mobilityWriter)
+  {
+    mobilityWriter->Close ();
+  }
+
+  if (flowStatsCollector)
+  {
+    flowStatsCollector->Dump ();
+  }
+
+  if (steeringStats)
+  {
+    // the share of each leg and the reordering caused by the split, per bearer
+    PsSimulationConfig::WriteMcSteeringStats ((forkRuns > 0 ? WarmStart::GetFilePath () : filePath) + "steering-stats.txt");
+  }
+
   return 0;
 }
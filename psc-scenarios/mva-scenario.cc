@@ -39,9 +39,31 @@ main (int argc, char *argv[])
   double firstRespondersVideoRate = 600e3; // data rate of the applications installed in the first responders [bit/s]
   double ratioDlFlows = 0.5; // ratio of first responders streaming a video in DL
   double packetSize = 1024; // packet size [bytes]
+  bool binaryAppTraces = false; // if true, write the application traces as buffered binary records
+  bool flowStats = false; // if true, collect per-flow delay, jitter and loss statistics instead of the application traces
+  uint32_t flowStatsInterval = 0; // interval between two dumps of the flow statistics in milliseconds, if 0 dump only at the end
+  bool profileEvents = false; // if true, profile the wall time of the scheduled events
+  uint32_t profileBin = 100; // width of the bins of the event timeline in milliseconds
+  bool videoFrames = false; // if true, the video feeds send whole frames at the frame rate instead of constant bit rate packets
+  uint32_t mobilityInterval = 1000; // interval between two samples of the node positions in milliseconds, if 0 the positions are not sampled
+  std::string mobilityNodes = "ues"; // nodes whose positions are sampled, "ues" or "all"
+  uint32_t forkRuns = 0; // number of runs forked at the warm start checkpoint, if 0 the warm start is disabled
+  uint32_t forkAt = 400; // time of the warm start checkpoint in milliseconds, after the network attach
+  double convergencePrecision = 0; // relative half-width of the 95% confidence intervals of the KPIs at which the run stops, if 0 the run is not stopped early
+  std::string convergenceMetrics = "throughput,delay"; // KPIs of the early stop, comma-separated list of throughput and delay
+  uint32_t convergenceBatch = 100; // length of the batches of the early stop in milliseconds
+  uint32_t convergenceMinTime = 0; // minimum simulation time in milliseconds before an early stop
+  uint32_t memoryInterval = 0; // interval between two samples of the memory of the process in milliseconds, if 0 the memory is not sampled
+  uint32_t associationInterval = 0; // interval between two checks of the closest BS of each UE in milliseconds, if 0 the association is not checked
+  bool associationHandover = false; // if true, the UEs not connected to their closest BS are handed over to it at each check of the association
+  uint32_t traceWindow = 0; // window of the aggregated PHY, RLC and PDCP traces in milliseconds, if 0 the full traces are written
+  std::string traceDetailLayers = ""; // layers whose received PDUs are still written in full with traceWindow, comma-separated list of phy, rlc, pdcp and buffer
+  std::string traceDetailRntis = ""; // RNTIs whose PDUs are written in full for traceDetailLayers, comma-separated, if empty all the RNTIs
+  uint32_t traceBufferInterval = 0; // interval between two samples of the RLC buffers with traceWindow in milliseconds, if 0 the buffers are not sampled
 
   // SIMULATION MODE
   bool useMmWave = true;
+  bool lteOnly = false; // if true, install a plain LTE deployment, without the mmWave BSs and the multi-connectivity UEs
 
   // LAYOUT
   double streetWidth = 2.75 * 2; // street width in meters
@@ -63,6 +85,7 @@ main (int argc, char *argv[])
 
   double interBsDistance = 50; // inter-BS distance in meters
   double lteDistanceFromScenario = 500; // m, distance of the LTE macro from the incident scene
+  std::string layoutCache = ""; // folder of the layout snapshots, if empty the layout is generated in every run
 
   // UE DISTRIBUTION
   uint32_t numFirstResponders = 10; // number of first responders
@@ -81,6 +104,14 @@ main (int argc, char *argv[])
   // RLC PARAMETERS
   bool rlcAm = true; // if true use RLC AM, if false use RLC UM
   uint32_t rlcBufSize = 10; // RLC buffer size
+  double rlcTxBudget = 0; // MB divided evenly into the cap of the transmission buffer of each RLC entity, if 0 each buffer has rlcBufSize MB
+
+  // MULTI-CONNECTIVITY PARAMETERS
+  std::string steeringPolicy = "qci-threshold"; // policy which splits the downlink SDUs between LTE and mmWave, qci-threshold, fixed-split or queue-delay
+  double lteSplitRatio = 0.5; // share of the downlink bytes sent on LTE with the fixed-split policy
+  uint32_t lteMaxQueueDelay = 10; // maximum queueing delay in the LTE RLC buffer with the queue-delay policy in milliseconds
+  std::string qciSteeringTable = ""; // comma-separated list of qci:lteShare, the bearers with these QCIs use a fixed split with their share
+  bool steeringStats = false; // if true, write the per-bearer steering statistics to steering-stats.txt
 
 
   CommandLine cmd;
@@ -91,7 +122,29 @@ main (int argc, char *argv[])
   cmd.AddValue ("appStart", "applications start time in milliseconds", appStart);
   cmd.AddValue ("firstRespondersVideoRate", "data rate of the applications installed in the first responders [bit/s]", firstRespondersVideoRate);
   cmd.AddValue ("packetSize", "packet size [bytes]", packetSize);
+  cmd.AddValue ("binaryAppTraces", "if true, write the application traces as buffered binary records", binaryAppTraces);
+  cmd.AddValue ("flowStats", "if true, collect per-flow delay, jitter and loss statistics instead of the application traces", flowStats);
+  cmd.AddValue ("flowStatsInterval", "interval between two dumps of the flow statistics in milliseconds, if 0 dump only at the end", flowStatsInterval);
+  cmd.AddValue ("profileEvents", "if true, profile the wall time of the scheduled events", profileEvents);
+  cmd.AddValue ("profileBin", "width of the bins of the event timeline in milliseconds", profileBin);
+  cmd.AddValue ("videoFrames", "if true, the video feeds send whole frames at the frame rate instead of constant bit rate packets", videoFrames);
+  cmd.AddValue ("mobilityInterval", "interval between two samples of the node positions in milliseconds, if 0 the positions are not sampled", mobilityInterval);
+  cmd.AddValue ("mobilityNodes", "nodes whose positions are sampled, ues or all", mobilityNodes);
+  cmd.AddValue ("forkRuns", "number of runs forked at the warm start checkpoint, if 0 the warm start is disabled", forkRuns);
+  cmd.AddValue ("forkAt", "time of the warm start checkpoint in milliseconds, after the network attach", forkAt);
+  cmd.AddValue ("convergencePrecision", "relative half-width of the 95% confidence intervals of the KPIs at which the run stops, if 0 the run is not stopped early", convergencePrecision);
+  cmd.AddValue ("convergenceMetrics", "KPIs of the early stop, comma-separated list of throughput and delay", convergenceMetrics);
+  cmd.AddValue ("convergenceBatch", "length of the batches of the early stop in milliseconds", convergenceBatch);
+  cmd.AddValue ("convergenceMinTime", "minimum simulation time in milliseconds before an early stop", convergenceMinTime);
+  cmd.AddValue ("memoryInterval", "interval between two samples of the memory of the process in milliseconds, if 0 the memory is not sampled", memoryInterval);
+  cmd.AddValue ("associationInterval", "interval between two checks of the closest BS of each UE in milliseconds, if 0 the association is not checked", associationInterval);
+  cmd.AddValue ("associationHandover", "if true, the UEs not connected to their closest BS are handed over to it at each check of the association", associationHandover);
+  cmd.AddValue ("traceWindow", "window of the aggregated PHY, RLC and PDCP traces in milliseconds, if 0 the full traces are written", traceWindow);
+  cmd.AddValue ("traceDetailLayers", "layers whose received PDUs are still written in full with traceWindow, comma-separated list of phy, rlc, pdcp and buffer", traceDetailLayers);
+  cmd.AddValue ("traceDetailRntis", "RNTIs whose PDUs are written in full for traceDetailLayers, comma-separated, if empty all the RNTIs", traceDetailRntis);
+  cmd.AddValue ("traceBufferInterval", "interval between two samples of the RLC buffers with traceWindow in milliseconds, if 0 the buffers are not sampled", traceBufferInterval);
   cmd.AddValue ("useMmWave", "true if mmWave BSs are used", useMmWave);
+  cmd.AddValue ("lteOnly", "if true, install a plain LTE deployment, without the mmWave BSs and the multi-connectivity UEs", lteOnly);
   cmd.AddValue ("streetWidth", "street width in meters", streetWidth);
   cmd.AddValue ("streetLength", "street length in meters", streetLength);
   cmd.AddValue ("numInvolvedCars", "number of cars involved in the incident", numInvolvedCars);
@@ -103,6 +156,7 @@ main (int argc, char *argv[])
   cmd.AddValue ("truckLength", "truck length in meters", truckLength);
   cmd.AddValue ("truckHeight", "truck height in meters", truckHeight);
   cmd.AddValue ("numFirstResponders", "number of first responders", numFirstResponders);
+  cmd.AddValue ("layoutCache", "folder of the layout snapshots, if empty the layout is generated in every run", layoutCache);
   cmd.AddValue ("speed", "speed of first responders", speed);
 	cmd.AddValue ("numBs", "number of sites", numBs);
   cmd.AddValue ("numSectorsPerBs", "number of sectors per site", numSectorsPerBs);
@@ -114,8 +168,35 @@ main (int argc, char *argv[])
   cmd.AddValue ("numUeAntennaElements", "number of UE antenna elements", numUeAntennaElements);
   cmd.AddValue ("ueAntennaHeight", "UE antenna height", ueAntennaHeight);
   cmd.AddValue ("rlcAm", "if true use RLC AM, if false use RLC UM", rlcAm);
+  cmd.AddValue ("rlcTxBudget", "MB divided evenly into the cap of the transmission buffer of each RLC entity, if 0 each buffer has rlcBufSize MB", rlcTxBudget);
+  cmd.AddValue ("steeringPolicy", "policy which splits the downlink SDUs between LTE and mmWave, qci-threshold, fixed-split or queue-delay", steeringPolicy);
+  cmd.AddValue ("lteSplitRatio", "share of the downlink bytes sent on LTE with the fixed-split policy", lteSplitRatio);
+  cmd.AddValue ("lteMaxQueueDelay", "maximum queueing delay in the LTE RLC buffer with the queue-delay policy in milliseconds", lteMaxQueueDelay);
+  cmd.AddValue ("qciSteeringTable", "comma-separated list of qci:lteShare, the bearers with these QCIs use a fixed split with their share", qciSteeringTable);
+  cmd.AddValue ("steeringStats", "if true, write the per-bearer steering statistics to steering-stats.txt", steeringStats);
   cmd.Parse (argc, argv);
 
+  if (profileEvents)
+  {
+    // EventProfile.txt and EventTimeline.txt are written when Simulator::Run returns
+    PsSimulationConfig::EnableEventProfiler (filePath, MilliSeconds (profileBin));
+  }
+
+  if (forkRuns > 0)
+  {
+    // at forkAt the process forks forkRuns children with runs runSet, runSet + 1, ...,
+    // which continue the simulation and write their outputs in filePath/fork-<i>/
+    NS_ABORT_MSG_IF (profileEvents, "The event profiler can't be used with the warm start");
+    // the files of the full traces and of the RLC AM buffer are opened by the modules and can't be moved in fork-<i>/
+    NS_ABORT_MSG_IF (traceWindow == 0, "The full traces can't be used with the warm start, use traceWindow");
+    NS_ABORT_MSG_IF (traceDetailLayers.find ("buffer") != std::string::npos, "The buffer trace layer can't be used with the warm start");
+    NS_ABORT_MSG_IF (forkAt >= simTime, "The warm start checkpoint must be before the end of the simulation");
+    WarmStart::Enable (MilliSeconds (forkAt), forkRuns, filePath, runSet);
+  }
+
+  // the multi-connectivity UEs are only monitored, see AssociationMonitor
+  NS_ABORT_MSG_IF (associationHandover && !lteOnly, "The association handover can be used only with lteOnly");
+
   RngSeedManager::SetSeed (seedSet);
   RngSeedManager::SetRun (runSet);
 
@@ -134,6 +215,8 @@ main (int argc, char *argv[])
   Config::SetDefault ("ns3::MmWaveHelper::PathlossModel", StringValue ("ns3::MmWave3gppBuildingsPropagationLossModel"));
   Config::SetDefault ("ns3::MmWave3gppPropagationLossModel::Scenario", StringValue ("UMa"));
   Config::SetDefault ("ns3::UdpClient::PacketSize", UintegerValue (packetSize));
+  Config::SetDefault ("ns3::VideoFrameClient::PacketSize", UintegerValue (packetSize));
+  PsSimulationConfig::SetVideoFrameSource (videoFrames); // all the flows are video feeds
   Config::SetDefault ("ns3::LteRlcAm::MaxTxBufferSize", UintegerValue (rlcBufSize * 1024 * 1024));
   Config::SetDefault ("ns3::LteRlcUm::MaxTxBufferSize", UintegerValue (rlcBufSize * 1024 * 1024));
   Config::SetDefault ("ns3::LteRlcAm::PollRetransmitTimer", TimeValue(MilliSeconds(1.0)));
@@ -143,18 +226,37 @@ main (int argc, char *argv[])
   Config::SetDefault ("ns3::LteRlcUm::ReportBufferStatusTimer", TimeValue(MicroSeconds(500)));
   Config::SetDefault ("ns3::MmWaveHelper::RlcAmEnabled", BooleanValue(rlcAm));
 
-  if (!useMmWave)
+  if (lteOnly)
+  {
+    // MmWaveHelper::RlcAmEnabled has no effect on LteHelper
+    Config::SetDefault ("ns3::LteEnbRrc::EpsBearerToRlcMapping", EnumValue (rlcAm ? LteEnbRrc::RLC_AM_ALWAYS : LteEnbRrc::RLC_UM_ALWAYS));
+  }
+  else if (!useMmWave)
   {
     Config::SetDefault ("ns3::McUePdcp::LteUplink", BooleanValue (true));
     Config::SetDefault ("ns3::McEnbPdcp::LteDownlink", BooleanValue (true));
     Config::SetDefault ("ns3::MmWave3gppChannel::UpdatePeriod", TimeValue (MilliSeconds (0))); // no need to update the mmwave channel
   }
-  PsSimulationConfig::SetTracesPath (filePath); // set the path where the traces will be saved
 
-  // Create the helpers
-  Ptr<MmWaveHelper> mmWaveHelper = CreateObject<MmWaveHelper> ();
+  // split of the downlink SDUs of the multi-connectivity bearers between LTE and mmWave
+  PsSimulationConfig::SetMcSteeringPolicy (steeringPolicy, lteSplitRatio, MilliSeconds (lteMaxQueueDelay), qciSteeringTable);
+  // set the path where the traces will be saved, with traceWindow RlcAmBufferSize.txt is discarded unless requested
+  PsSimulationConfig::SetTracesPath (filePath, traceWindow == 0 || traceDetailLayers.find ("buffer") != std::string::npos);
+
+  // Create the helpers, with lteOnly the mmwave stack is not instantiated at all
   Ptr<MmWavePointToPointEpcHelper> epcHelper = CreateObject<MmWavePointToPointEpcHelper> ();
-  mmWaveHelper->SetEpcHelper (epcHelper);
+  Ptr<MmWaveHelper> mmWaveHelper;
+  Ptr<LteHelper> lteHelper;
+  if (lteOnly)
+  {
+    // same pathloss model, scheduler, bandwidth and EARFCNs as the LTE cells of MmWaveHelper
+    lteHelper = PsSimulationConfig::CreateLteHelper (epcHelper);
+  }
+  else
+  {
+    mmWaveHelper = CreateObject<MmWaveHelper> ();
+    mmWaveHelper->SetEpcHelper (epcHelper);
+  }
 
   // Create the internet
   std::pair<Ptr<Node>, Ipv4Address> remoteHostPair;
@@ -170,47 +272,128 @@ main (int argc, char *argv[])
   firstRespondersNodes.Create(numFirstResponders);
 
   // LAYOUT
-  // the coordinates from which the scenario is generated are (0, 0)
-  // drop the cars
-  for (uint8_t i = 0; i < numInvolvedCars; i++)
+  // load the obstacles and the node positions from a previous run with the
+  // same seed, run and layout parameters, if available
+  Ptr<LayoutSnapshot> layoutSnapshot;
+  bool layoutFromSnapshot = false;
+  if (!layoutCache.empty ())
   {
-    PsSimulationConfig::CreateRandomObstacle (streetLength, streetWidth, carWidth, carLength, carHeight);
+    std::ostringstream layoutKey;
+    layoutKey.precision (17);
+    layoutKey << "mva-scenario"
+              << " seedSet=" << seedSet << " runSet=" << runSet
+              << " streetWidth=" << streetWidth << " streetLength=" << streetLength
+              << " numInvolvedCars=" << numInvolvedCars << " carWidth=" << carWidth
+              << " carLength=" << carLength << " carHeight=" << carHeight
+              << " numInvolvedTrucks=" << numInvolvedTrucks << " truckWidth=" << truckWidth
+              << " truckLength=" << truckLength << " truckHeight=" << truckHeight
+              << " numBs=" << numBs << " interBsDistance=" << interBsDistance
+              << " bsAntennaHeight=" << bsAntennaHeight << " numLteBs=" << numLteBs
+              << " lteDistanceFromScenario=" << lteDistanceFromScenario << " lteBsAntennaHeight=" << lteBsAntennaHeight
+              << " numFirstResponders=" << numFirstResponders << " ueAntennaHeight=" << ueAntennaHeight;
+    layoutSnapshot = Create<LayoutSnapshot> (layoutCache, layoutKey.str ());
+    layoutFromSnapshot = layoutSnapshot->Load ();
   }
 
-  // drop the trucks
-  for (uint8_t i = 0; i < numInvolvedTrucks; i++)
+  Ptr<PositionAllocator> firstRespondersPositions; // if 0, the first responders are dropped randomly
+  if (layoutFromSnapshot)
   {
-    PsSimulationConfig::CreateRandomObstacle (streetLength, streetWidth, truckWidth, truckLength, truckHeight);
+    // the obstacles have been created by the snapshot
+    layoutSnapshot->SetConstantPositionMobility (bsNodes);
+    layoutSnapshot->SetConstantPositionMobility (lteBsNodes);
+    firstRespondersPositions = layoutSnapshot->GetPositionAllocator (firstRespondersNodes);
+  }
+  else
+  {
+    // the coordinates from which the scenario is generated are (0, 0)
+    // drop the cars
+    for (uint8_t i = 0; i < numInvolvedCars; i++)
+    {
+      PsSimulationConfig::CreateRandomObstacle (streetLength, streetWidth, carWidth, carLength, carHeight);
+    }
+
+    // drop the trucks
+    for (uint8_t i = 0; i < numInvolvedTrucks; i++)
+    {
+      PsSimulationConfig::CreateRandomObstacle (streetLength, streetWidth, truckWidth, truckLength, truckHeight);
+    }
+
+    // drop the base stations
+    PsSimulationConfig::DropMmWaveRoadSideUnits(
+      -interBsDistance, streetLength + interBsDistance/2, -1, bsAntennaHeight, interBsDistance, bsNodes);
+
+    PsSimulationConfig::DropLteMacro(
+      lteDistanceFromScenario, lteBsAntennaHeight, lteBsNodes
+      );
   }
-
-  // drop the base stations
-  PsSimulationConfig::DropMmWaveRoadSideUnits(
-    -interBsDistance, streetLength + interBsDistance/2, -1, bsAntennaHeight, interBsDistance, bsNodes);
-
-  PsSimulationConfig::DropLteMacro(
-    lteDistanceFromScenario, lteBsAntennaHeight, lteBsNodes
-    );
 
   // drop the first responders
   PsSimulationConfig::DropFirstResponders (
-    -streetWidth / 2, streetWidth * 1.5, 0, streetLength, ueAntennaHeight, ueAntennaHeight, firstRespondersNodes);
+    -streetWidth / 2, streetWidth * 1.5, 0, streetLength, ueAntennaHeight, ueAntennaHeight, firstRespondersNodes, firstRespondersPositions);
+
+  if (layoutSnapshot && !layoutFromSnapshot)
+  {
+    layoutSnapshot->Save ();
+  }
 
   BuildingsHelper::MakeMobilityModelConsistent ();
 
-  NetDeviceContainer bsDevices = mmWaveHelper->InstallEnbDevice (bsNodes);
-  NetDeviceContainer lteBsDevices = mmWaveHelper->InstallLteEnbDevice (lteBsNodes);
-  NetDeviceContainer firstRespondersDevices = mmWaveHelper->InstallMcUeDevice (firstRespondersNodes);
+  NetDeviceContainer bsDevices;
+  NetDeviceContainer lteBsDevices;
+  NetDeviceContainer firstRespondersDevices;
+  if (lteOnly)
+  {
+    // the mmwave BS nodes are still dropped, so that the layout is the same, but have no devices
+    lteBsDevices = lteHelper->InstallEnbDevice (lteBsNodes);
+    firstRespondersDevices = lteHelper->InstallUeDevice (firstRespondersNodes);
+  }
+  else
+  {
+    bsDevices = mmWaveHelper->InstallEnbDevice (bsNodes);
+    lteBsDevices = mmWaveHelper->InstallLteEnbDevice (lteBsNodes);
+    firstRespondersDevices = mmWaveHelper->InstallMcUeDevice (firstRespondersNodes);
+  }
 
   Ipv4InterfaceContainer ueIpIface = PsSimulationConfig::InstallUeInternet (epcHelper, firstRespondersNodes, firstRespondersDevices);
 
   // Connect the bs
-  mmWaveHelper->AddX2Interface (lteBsNodes, bsNodes);
+  if (lteOnly)
+  {
+    lteHelper->AddX2Interface (lteBsNodes);
+    PsSimulationConfig::AttachToClosestEnb (lteHelper, firstRespondersDevices, lteBsDevices);
+  }
+  else
+  {
+    mmWaveHelper->AddX2Interface (lteBsNodes, bsNodes);
+    mmWaveHelper->AttachToClosestEnb(firstRespondersDevices, bsDevices, lteBsDevices);
+  }
 
-  mmWaveHelper->AttachToClosestEnb(firstRespondersDevices, bsDevices, lteBsDevices);
+  if (rlcTxBudget > 0)
+  {
+    // each first responder has a single bearer
+    PsSimulationConfig::SetRlcTxBufferCap (rlcTxBudget, firstRespondersDevices);
+  }
 
   // each first responder streams an uplink video feed
   AsciiTraceHelper asciiTraceHelper;
-  Ptr<OutputStreamWrapper> ulStream = asciiTraceHelper.CreateFileStream (filePath + "ul-app-trace.txt"); // trace file for UL traffic
+  Ptr<OutputStreamWrapper> ulStream; // trace file for UL traffic
+  Ptr<BinaryTraceWriter> ulWriter; // binary trace file for UL traffic
+  Ptr<FlowStatsCollector> flowStatsCollector; // per-flow statistics, for both UL and DL
+  if (flowStats)
+  {
+    flowStatsCollector = Create<FlowStatsCollector> (filePath + "flow-stats.txt", MilliSeconds (flowStatsInterval));
+    WarmStart::AddOutput (flowStatsCollector, "flow-stats.txt");
+  }
+  else if (binaryAppTraces)
+  {
+    ulWriter = Create<BinaryTraceWriter> (filePath + "ul-app-trace.bin");
+    WarmStart::AddOutput (ulWriter, "ul-app-trace.bin");
+  }
+  else
+  {
+    ulStream = asciiTraceHelper.CreateFileStream (filePath + "ul-app-trace.txt");
+    WarmStart::AddOutput (ulStream, "ul-app-trace.txt");
+  }
   uint16_t ulPort = 1235; // port on the remote host to which the UL traffic is delivered
   // crate a random variable to randomize the application start times of the
   // first responders
@@ -219,44 +402,218 @@ main (int argc, char *argv[])
   rv->SetAttribute ("Max", DoubleValue (600));
   for (uint32_t frIndex = 0; frIndex < firstRespondersNodes.GetN (); ++frIndex)
   {
-    PsSimulationConfig::SetupUplinkUdpFlow (
-      firstRespondersNodes.Get(frIndex), // source
-      remoteHostPair.first, // sink
-      remoteHostPair.second, // sink address
-      ulPort++, // port
-      MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
-      MilliSeconds (appStart + rv->GetValue ()), // start time of the application [ms]
-      MilliSeconds (simTime - 100), // end time of the application [ms]
-      ulStream // trace
-    );
+    if (flowStats)
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        firstRespondersNodes.Get(frIndex), // source
+        remoteHostPair.first, // sink
+        remoteHostPair.second, // sink address
+        ulPort++, // port
+        MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (appStart + rv->GetValue ()), // start time of the application [ms]
+        MilliSeconds (simTime - 100), // end time of the application [ms]
+        flowStatsCollector, // flow statistics
+        "ul-video" // name of the flow
+      );
+    }
+    else if (binaryAppTraces)
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        firstRespondersNodes.Get(frIndex), // source
+        remoteHostPair.first, // sink
+        remoteHostPair.second, // sink address
+        ulPort++, // port
+        MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (appStart + rv->GetValue ()), // start time of the application [ms]
+        MilliSeconds (simTime - 100), // end time of the application [ms]
+        ulWriter // binary trace
+      );
+    }
+    else
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        firstRespondersNodes.Get(frIndex), // source
+        remoteHostPair.first, // sink
+        remoteHostPair.second, // sink address
+        ulPort++, // port
+        MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (appStart + rv->GetValue ()), // start time of the application [ms]
+        MilliSeconds (simTime - 100), // end time of the application [ms]
+        ulStream // trace
+      );
+    }
   }
 
   NS_LOG_DEBUG ("FR applications inter-packet interval " << packetSize * 8 / firstRespondersVideoRate * 1e6);
 
   // some first responders watches a downlink video feed
-  Ptr<OutputStreamWrapper> dlStream = asciiTraceHelper.CreateFileStream (filePath + "dl-app-trace.txt"); // trace file for DL traffic
+  Ptr<OutputStreamWrapper> dlStream; // trace file for DL traffic
+  Ptr<BinaryTraceWriter> dlWriter; // binary trace file for DL traffic
+  if (binaryAppTraces && !flowStats)
+  {
+    dlWriter = Create<BinaryTraceWriter> (filePath + "dl-app-trace.bin");
+    WarmStart::AddOutput (dlWriter, "dl-app-trace.bin");
+  }
+  else if (!flowStats)
+  {
+    dlStream = asciiTraceHelper.CreateFileStream (filePath + "dl-app-trace.txt");
+    WarmStart::AddOutput (dlStream, "dl-app-trace.txt");
+  }
   uint16_t dlPort = ulPort + numFirstResponders; // port on the UE to which the DL traffic is delivered
   for (uint32_t frIndex = 0; frIndex < std::floor(firstRespondersNodes.GetN () * ratioDlFlows); ++frIndex)
   {
-    PsSimulationConfig::SetupUplinkUdpFlow (
-      remoteHostPair.first, // source
-      firstRespondersNodes.Get(frIndex), // sink
-      ueIpIface.GetAddress(frIndex), // sink address
-      dlPort++, // port
-      MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
-      MilliSeconds (appStart + rv->GetValue ()), // start time of the application [ms]
-      MilliSeconds (simTime - 100), // end time of the application [ms]
-      dlStream // trace
-    );
+    if (flowStats)
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        remoteHostPair.first, // source
+        firstRespondersNodes.Get(frIndex), // sink
+        ueIpIface.GetAddress(frIndex), // sink address
+        dlPort++, // port
+        MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (appStart + rv->GetValue ()), // start time of the application [ms]
+        MilliSeconds (simTime - 100), // end time of the application [ms]
+        flowStatsCollector, // flow statistics
+        "dl-video" // name of the flow
+      );
+    }
+    else if (binaryAppTraces)
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        remoteHostPair.first, // source
+        firstRespondersNodes.Get(frIndex), // sink
+        ueIpIface.GetAddress(frIndex), // sink address
+        dlPort++, // port
+        MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (appStart + rv->GetValue ()), // start time of the application [ms]
+        MilliSeconds (simTime - 100), // end time of the application [ms]
+        dlWriter // binary trace
+      );
+    }
+    else
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        remoteHostPair.first, // source
+        firstRespondersNodes.Get(frIndex), // sink
+        ueIpIface.GetAddress(frIndex), // sink address
+        dlPort++, // port
+        MicroSeconds (packetSize * 8 / firstRespondersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (appStart + rv->GetValue ()), // start time of the application [ms]
+        MilliSeconds (simTime - 100), // end time of the application [ms]
+        dlStream // trace
+      );
+    }
   }
 
-  mmWaveHelper->EnableTraces ();
+  // one line per window and user instead of one per PDU or transport block
+  Ptr<WindowedTraceAggregator> traceAggregator;
+  if (traceWindow > 0)
+  {
+    traceAggregator = Create<WindowedTraceAggregator> (filePath, MilliSeconds (traceWindow), traceDetailLayers, traceDetailRntis);
+    if (traceBufferInterval > 0)
+    {
+      traceAggregator->EnableBufferSampling (MilliSeconds (traceBufferInterval));
+    }
+    WarmStart::AddOutput (traceAggregator, "");
+  }
+  else if (lteOnly)
+  {
+    lteHelper->EnableRlcTraces ();
+    lteHelper->EnablePdcpTraces ();
+  }
+  else
+  {
+    mmWaveHelper->EnableTraces ();
+  }
 
-  PrintHelper::PrintGnuplottableBuildingListToFile ("obstacles.txt");
-  PrintHelper::PrintGnuplottableNodeListToFile ("nodes.txt");
+  PrintHelper::PrintGnuplottableBuildingListToFile (filePath + "obstacles.txt");
+  PrintHelper::PrintGnuplottableNodeListToFile (filePath + "nodes.txt");
+
+  // the positions of the nodes are sampled in a single event every mobilityInterval,
+  // scripts/convert_mobility_trace.pl converts them to the gnuplot labels of nodes.txt
+  Ptr<MobilitySnapshotWriter> mobilityWriter;
+  if (mobilityInterval > 0)
+  {
+    NS_ABORT_MSG_IF (mobilityNodes != "ues" && mobilityNodes != "all", "Unknown mobilityNodes " << mobilityNodes);
+    NodeContainer sampledNodes = (mobilityNodes == "all") ? NodeContainer::GetGlobal () : PrintHelper::GetUeNodes ();
+    mobilityWriter = Create<MobilitySnapshotWriter> (filePath + "mobility.bin", sampledNodes, MilliSeconds (mobilityInterval));
+    WarmStart::AddOutput (mobilityWriter, "mobility.bin");
+  }
+
+  // the simulation stops at the end of the first batch in which the KPIs
+  // of all the sinks have converged, or at the usual stop time otherwise
+  Ptr<ConvergenceMonitor> convergenceMonitor;
+  if (convergencePrecision > 0)
+  {
+    convergenceMonitor = Create<ConvergenceMonitor> (convergenceMetrics, MilliSeconds (convergenceBatch),
+                                                     convergencePrecision, MilliSeconds (convergenceMinTime));
+  }
+
+  // the memory of the process over the simulation time, to size the runs
+  Ptr<MemorySampler> memorySampler;
+  if (memoryInterval > 0)
+  {
+    memorySampler = Create<MemorySampler> (filePath + "memory.txt", MilliSeconds (memoryInterval));
+    WarmStart::AddOutput (memorySampler, "memory.txt");
+  }
+
+  // the UEs which are not connected to their closest BS
+  Ptr<AssociationMonitor> associationMonitor;
+  if (associationInterval > 0)
+  {
+    associationMonitor = Create<AssociationMonitor> (filePath + "association.txt", MilliSeconds (associationInterval),
+                                                     firstRespondersDevices, lteOnly ? lteBsDevices : bsDevices);
+    WarmStart::AddOutput (associationMonitor, "association.txt");
+    if (associationHandover)
+    {
+      associationMonitor->EnableHandover (); // the LTE BSs are connected by X2
+    }
+  }
 
   Simulator::Stop(MilliSeconds (simTime));
   Simulator::Run();
 
+  if (convergenceMonitor)
+  {
+    convergenceMonitor->Report ();
+  }
+
+  if (memorySampler)
+  {
+    memorySampler->Close ();
+  }
+
+  if (associationMonitor)
+  {
+    associationMonitor->Report ();
+    associationMonitor->Close ();
+  }
+
+  if (traceAggregator)
+  {
+    traceAggregator->Close ();
+  }
+
+  if (mobilityWriter)
+  {
+    mobilityWriter->Close ();
+  }
+
+  if (flowStatsCollector)
+  {
+    flowStatsCollector->Dump ();
+  }
+  else if (binaryAppTraces)
+  {
+    ulWriter->Close ();
+    dlWriter->Close ();
+  }
+
+  if (steeringStats)
+  {
+    // the share of each leg and the reordering caused by the split, per bearer
+    PsSimulationConfig::WriteMcSteeringStats ((forkRuns > 0 ? WarmStart::GetFilePath () : filePath) + "steering-stats.txt");
+  }
+
+
   return 0;
 }
@@ -34,6 +34,27 @@ main (int argc, char *argv[])
   uint32_t appStart = 500; // applications start time in milliseconds
   double officersVideoRate = 100e6; // data rate of the applications installed in the first responders [bit/s]
   double packetSize = 1024; // packet size [bytes]
+  bool binaryAppTraces = false; // if true, write the application traces as buffered binary records
+  bool flowStats = false; // if true, collect per-flow delay, jitter and loss statistics instead of the application traces
+  uint32_t flowStatsInterval = 0; // interval between two dumps of the flow statistics in milliseconds, if 0 dump only at the end
+  bool profileEvents = false; // if true, profile the wall time of the scheduled events
+  uint32_t profileBin = 100; // width of the bins of the event timeline in milliseconds
+  bool videoFrames = false; // if true, the video feeds send whole frames at the frame rate instead of constant bit rate packets
+  uint32_t mobilityInterval = 1000; // interval between two samples of the node positions in milliseconds, if 0 the positions are not sampled
+  std::string mobilityNodes = "ues"; // nodes whose positions are sampled, "ues" or "all"
+  uint32_t forkRuns = 0; // number of runs forked at the warm start checkpoint, if 0 the warm start is disabled
+  uint32_t forkAt = 400; // time of the warm start checkpoint in milliseconds, after the network attach
+  double convergencePrecision = 0; // relative half-width of the 95% confidence intervals of the KPIs at which the run stops, if 0 the run is not stopped early
+  std::string convergenceMetrics = "throughput,delay"; // KPIs of the early stop, comma-separated list of throughput and delay
+  uint32_t convergenceBatch = 100; // length of the batches of the early stop in milliseconds
+  uint32_t convergenceMinTime = 0; // minimum simulation time in milliseconds before an early stop
+  uint32_t memoryInterval = 0; // interval between two samples of the memory of the process in milliseconds, if 0 the memory is not sampled
+  uint32_t associationInterval = 0; // interval between two checks of the closest BS of each UE in milliseconds, if 0 the association is not checked
+  bool associationHandover = false; // if true, the UEs not connected to their closest BS are handed over to it at each check of the association
+  uint32_t traceWindow = 0; // window of the aggregated PHY, RLC and PDCP traces in milliseconds, if 0 the full traces are written
+  std::string traceDetailLayers = ""; // layers whose received PDUs are still written in full with traceWindow, comma-separated list of phy, rlc, pdcp and buffer
+  std::string traceDetailRntis = ""; // RNTIs whose PDUs are written in full for traceDetailLayers, comma-separated, if empty all the RNTIs
+  uint32_t traceBufferInterval = 0; // interval between two samples of the RLC buffers with traceWindow in milliseconds, if 0 the buffers are not sampled
 
   // LAYOUT
   double corridorWidth = 3.5; // corridor width in meters
@@ -70,10 +91,12 @@ main (int argc, char *argv[])
 
   bool useIab = true; // if true, the SWAT team leader carries an IAB rely
 
-  uint32_t mobilityMode = 1; // with mobility mode 1 the IAB follows the team,
+  uint32_t mobilityMode = 2; // with mobility mode 1 the IAB follows the team,
                              // with mobility mode 2 the IAB stops before the
                              // corner in such a way to be always LOS with the
                              // donor
+  std::string swatEntryPoints = "corners"; // entry points of the SWAT teams, corners
+                                           // or corridors
 
   CommandLine cmd;
   cmd.AddValue ("filePath", "path for the output files", filePath);
@@ -82,6 +105,27 @@ main (int argc, char *argv[])
   cmd.AddValue ("appStart", "applications start time in milliseconds", appStart);
   cmd.AddValue ("officersVideoRate", "data rate of the applications installed in the first responders [bit/s]", officersVideoRate);
   cmd.AddValue ("packetSize", "packet size [bytes]", packetSize);
+  cmd.AddValue ("binaryAppTraces", "if true, write the application traces as buffered binary records", binaryAppTraces);
+  cmd.AddValue ("flowStats", "if true, collect per-flow delay, jitter and loss statistics instead of the application traces", flowStats);
+  cmd.AddValue ("flowStatsInterval", "interval between two dumps of the flow statistics in milliseconds, if 0 dump only at the end", flowStatsInterval);
+  cmd.AddValue ("profileEvents", "if true, profile the wall time of the scheduled events", profileEvents);
+  cmd.AddValue ("profileBin", "width of the bins of the event timeline in milliseconds", profileBin);
+  cmd.AddValue ("videoFrames", "if true, the video feeds send whole frames at the frame rate instead of constant bit rate packets", videoFrames);
+  cmd.AddValue ("mobilityInterval", "interval between two samples of the node positions in milliseconds, if 0 the positions are not sampled", mobilityInterval);
+  cmd.AddValue ("mobilityNodes", "nodes whose positions are sampled, ues or all", mobilityNodes);
+  cmd.AddValue ("forkRuns", "number of runs forked at the warm start checkpoint, if 0 the warm start is disabled", forkRuns);
+  cmd.AddValue ("forkAt", "time of the warm start checkpoint in milliseconds, after the network attach", forkAt);
+  cmd.AddValue ("convergencePrecision", "relative half-width of the 95% confidence intervals of the KPIs at which the run stops, if 0 the run is not stopped early", convergencePrecision);
+  cmd.AddValue ("convergenceMetrics", "KPIs of the early stop, comma-separated list of throughput and delay", convergenceMetrics);
+  cmd.AddValue ("convergenceBatch", "length of the batches of the early stop in milliseconds", convergenceBatch);
+  cmd.AddValue ("convergenceMinTime", "minimum simulation time in milliseconds before an early stop", convergenceMinTime);
+  cmd.AddValue ("memoryInterval", "interval between two samples of the memory of the process in milliseconds, if 0 the memory is not sampled", memoryInterval);
+  cmd.AddValue ("associationInterval", "interval between two checks of the closest BS of each UE in milliseconds, if 0 the association is not checked", associationInterval);
+  cmd.AddValue ("associationHandover", "if true, the UEs not connected to their closest BS are handed over to it at each check of the association", associationHandover);
+  cmd.AddValue ("traceWindow", "window of the aggregated PHY, RLC and PDCP traces in milliseconds, if 0 the full traces are written", traceWindow);
+  cmd.AddValue ("traceDetailLayers", "layers whose received PDUs are still written in full with traceWindow, comma-separated list of phy, rlc, pdcp and buffer", traceDetailLayers);
+  cmd.AddValue ("traceDetailRntis", "RNTIs whose PDUs are written in full for traceDetailLayers, comma-separated, if empty all the RNTIs", traceDetailRntis);
+  cmd.AddValue ("traceBufferInterval", "interval between two samples of the RLC buffers with traceWindow in milliseconds, if 0 the buffers are not sampled", traceBufferInterval);
   cmd.AddValue ("corridorWidth", "corridor width in meters", corridorWidth);
   cmd.AddValue ("roomWidthX", "room width in the x axis meters", roomWidthX);
   cmd.AddValue ("roomWidthY", "room width in the y axis meters", roomWidthY);
@@ -104,13 +148,34 @@ main (int argc, char *argv[])
   cmd.AddValue ("rlcAm", "if true use RLC AM, if false use RLC UM", rlcAm);
   cmd.AddValue ("useIab", "if true, the SWAT team leader carries an IAB rely", useIab);
   cmd.AddValue ("mobilityMode", "with mobility mode 1 the IAB follows the team, with mobility mode 2 the IAB stops before the corner in such a way to be always LOS with the donor", mobilityMode);
+  cmd.AddValue ("swatEntryPoints", "entry points of the SWAT teams: corners (the corners of the building) or corridors (also the ends of the corridors)", swatEntryPoints);
   cmd.Parse (argc, argv);
 
+  if (profileEvents)
+  {
+    // EventProfile.txt and EventTimeline.txt are written when Simulator::Run returns
+    PsSimulationConfig::EnableEventProfiler (filePath, MilliSeconds (profileBin));
+  }
+
+  if (forkRuns > 0)
+  {
+    // at forkAt the process forks forkRuns children with runs runSet, runSet + 1, ...,
+    // which continue the simulation and write their outputs in filePath/fork-<i>/
+    NS_ABORT_MSG_IF (profileEvents, "The event profiler can't be used with the warm start");
+    // the files of the full traces and of the RLC AM buffer are opened by the modules and can't be moved in fork-<i>/
+    NS_ABORT_MSG_IF (traceWindow == 0, "The full traces can't be used with the warm start, use traceWindow");
+    NS_ABORT_MSG_IF (traceDetailLayers.find ("buffer") != std::string::npos, "The buffer trace layer can't be used with the warm start");
+    WarmStart::Enable (MilliSeconds (forkAt), forkRuns, filePath, runSet);
+  }
+
   RngSeedManager::SetSeed (seedSet);
   RngSeedManager::SetRun (runSet);
 
   NS_ABORT_MSG_IF(numBs > 4, "Too many wired BSs");
   NS_ABORT_MSG_IF(numRoomsRow % 2 != 0 || numRoomsColumn % 2 != 0, "Please use an even number of rooms");
+  NS_ABORT_MSG_IF(mobilityMode != 1 && mobilityMode != 2, "Unknown mobility mode " << mobilityMode);
+  // the IAB nodes are only monitored, see AssociationMonitor
+  NS_ABORT_MSG_IF(associationHandover && useIab, "The association handover can't be used with the IAB nodes");
 
   Config::SetDefault ("ns3::MmWavePhyMacCommon::CenterFreq", DoubleValue (frequency));
   Config::SetDefault ("ns3::MmWavePhyMacCommon::ChunkPerRB", UintegerValue (72 * bandwidth / 1e9));
@@ -127,6 +192,8 @@ main (int argc, char *argv[])
   Config::SetDefault ("ns3::MmWave3gppPropagationLossModel::Scenario", StringValue ("InH-OfficeMixed"));
 
   Config::SetDefault ("ns3::UdpClient::PacketSize", UintegerValue (packetSize));
+  Config::SetDefault ("ns3::VideoFrameClient::PacketSize", UintegerValue (packetSize));
+  PsSimulationConfig::SetVideoFrameSource (videoFrames); // all the flows are video feeds
   Config::SetDefault ("ns3::MmWavePhyMacCommon::SymbolsPerSubframe", UintegerValue(240));
   Config::SetDefault ("ns3::MmWavePhyMacCommon::SubframePeriod", DoubleValue(1000));
   Config::SetDefault("ns3::MmWavePhyMacCommon::UlSchedDelay", UintegerValue(1));
@@ -140,7 +207,8 @@ main (int argc, char *argv[])
   Config::SetDefault ("ns3::MmWaveHelper::RlcAmEnabled", BooleanValue(rlcAm));
   Config::SetDefault ("ns3::MmWaveFlexTtiMacScheduler::CqiTimerThreshold", UintegerValue(100));
 
-  PsSimulationConfig::SetTracesPath (filePath); // set the path where the traces will be saved
+  // set the path where the traces will be saved, with traceWindow RlcAmBufferSize.txt is discarded unless requested
+  PsSimulationConfig::SetTracesPath (filePath, traceWindow == 0 || traceDetailLayers.find ("buffer") != std::string::npos);
 
   // Create the helpers
   Ptr<MmWaveHelper> mmWaveHelper = CreateObject<MmWaveHelper> ();
@@ -180,6 +248,7 @@ main (int argc, char *argv[])
   // maximum time it takes to reach the center after the application has started
   double maximumDuration = (double)appStart / 1000 + (halfBuildingCorridorRow + halfBuildingCorridorColumn) / swatTeamMinSpeed + 0.1; // 0.1 to let the app stop
   uint32_t appEnd = std::ceil(maximumDuration * 1000) - 100; // applications end time in milliseconds
+  NS_ABORT_MSG_IF (forkRuns > 0 && forkAt >= appEnd, "The warm start checkpoint must be before the end of the applications");
 
   std::vector< Ptr<Building> > rooms = GridBuildings::CreateGridBuildings (numRoomsRow,
                                                                            numRoomsColumn,
@@ -194,8 +263,11 @@ main (int argc, char *argv[])
   PsSimulationConfig::SetConstantPositionMobility (fixedWiredBackhaulNodes.Get(2), Vector(buildingSizeX + 1, buildingSizeY + 1, bsAntennaHeight));
   PsSimulationConfig::SetConstantPositionMobility (fixedWiredBackhaulNodes.Get(3), Vector(-1, buildingSizeY + 1, bsAntennaHeight));
 
-  // drop the SWAT teams
-  PsSimulationConfig::DropSwatTeams (swatTeams, iabNodesForSwatTeams, buildingSizeX, buildingSizeY, ueAntennaHeight, randomSpeed, maximumDuration);
+  // drop the SWAT teams, which walk along the shortest corridor routes
+  // from their entry points to the center of the building
+  GridCorridorPlanner planner (numRoomsRow, numRoomsColumn, corridorWidth, roomWidthX, roomWidthY);
+  PsSimulationConfig::DropSwatTeams (swatTeams, iabNodesForSwatTeams, planner, swatEntryPoints, fixedWiredBackhaulNodes,
+                                     mobilityMode == 2, ueAntennaHeight, randomSpeed, maximumDuration);
   BuildingsHelper::MakeMobilityModelConsistent ();
 
   NetDeviceContainer donorDevs = mmWaveHelper->InstallEnbDevice (fixedWiredBackhaulNodes);
@@ -218,40 +290,179 @@ main (int argc, char *argv[])
   }
   else
   {
-    mmWaveHelper->AttachToClosestEnb (ueDevs, donorDevs);
+    PsSimulationConfig::AttachToClosestEnb (mmWaveHelper, ueDevs, donorDevs);
+    if (associationHandover)
+    {
+      mmWaveHelper->AddX2Interface (fixedWiredBackhaulNodes); // the UEs are handed over between the wired BSs
+    }
   }
 
   // each swat member streams an uplink video feed
   AsciiTraceHelper asciiTraceHelper;
-  Ptr<OutputStreamWrapper> ulStream = asciiTraceHelper.CreateFileStream (filePath + "ul-app-trace.txt"); // trace file for UL traffic
+  Ptr<OutputStreamWrapper> ulStream; // trace file for UL traffic
+  Ptr<BinaryTraceWriter> ulWriter; // binary trace file for UL traffic
+  Ptr<FlowStatsCollector> flowStatsCollector; // per-flow statistics
+  if (flowStats)
+  {
+    flowStatsCollector = Create<FlowStatsCollector> (filePath + "flow-stats.txt", MilliSeconds (flowStatsInterval));
+    WarmStart::AddOutput (flowStatsCollector, "flow-stats.txt");
+  }
+  else if (binaryAppTraces)
+  {
+    ulWriter = Create<BinaryTraceWriter> (filePath + "ul-app-trace.bin");
+    WarmStart::AddOutput (ulWriter, "ul-app-trace.bin");
+  }
+  else
+  {
+    ulStream = asciiTraceHelper.CreateFileStream (filePath + "ul-app-trace.txt");
+    WarmStart::AddOutput (ulStream, "ul-app-trace.txt");
+  }
   uint16_t ulPort = 1235; // port on the remote host to which the UL traffic is delivered
   for (uint32_t swIndex = 0; swIndex < allOfficers.GetN(); ++swIndex)
   {
-    PsSimulationConfig::SetupUplinkUdpFlow (
-      allOfficers.Get(swIndex), // source
-      remoteHostPair.first, // sink
-      remoteHostPair.second, // sink address
-      ulPort++, // port
-      MicroSeconds (packetSize * 8 / officersVideoRate * 1e6), // time interval between consecutive packets [us]
-      MilliSeconds (appStart), // start time of the application [ms]
-      MilliSeconds (appEnd), // end time of the application [ms]
-      ulStream // trace
-    );
+    if (flowStats)
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        allOfficers.Get(swIndex), // source
+        remoteHostPair.first, // sink
+        remoteHostPair.second, // sink address
+        ulPort++, // port
+        MicroSeconds (packetSize * 8 / officersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (appStart), // start time of the application [ms]
+        MilliSeconds (appEnd), // end time of the application [ms]
+        flowStatsCollector, // flow statistics
+        "ul-video" // name of the flow
+      );
+    }
+    else if (binaryAppTraces)
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        allOfficers.Get(swIndex), // source
+        remoteHostPair.first, // sink
+        remoteHostPair.second, // sink address
+        ulPort++, // port
+        MicroSeconds (packetSize * 8 / officersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (appStart), // start time of the application [ms]
+        MilliSeconds (appEnd), // end time of the application [ms]
+        ulWriter // binary trace
+      );
+    }
+    else
+    {
+      PsSimulationConfig::SetupUplinkUdpFlow (
+        allOfficers.Get(swIndex), // source
+        remoteHostPair.first, // sink
+        remoteHostPair.second, // sink address
+        ulPort++, // port
+        MicroSeconds (packetSize * 8 / officersVideoRate * 1e6), // time interval between consecutive packets [us]
+        MilliSeconds (appStart), // start time of the application [ms]
+        MilliSeconds (appEnd), // end time of the application [ms]
+        ulStream // trace
+      );
+    }
   }
 
   NS_LOG_DEBUG ("UDP application interpacket interval " << packetSize * 8 / officersVideoRate * 1e6 << " micro seconds");
 
-  mmWaveHelper->EnableTraces ();
+  // one line per window and user instead of one per PDU or transport block
+  Ptr<WindowedTraceAggregator> traceAggregator;
+  if (traceWindow > 0)
+  {
+    traceAggregator = Create<WindowedTraceAggregator> (filePath, MilliSeconds (traceWindow), traceDetailLayers, traceDetailRntis);
+    if (traceBufferInterval > 0)
+    {
+      traceAggregator->EnableBufferSampling (MilliSeconds (traceBufferInterval));
+    }
+    WarmStart::AddOutput (traceAggregator, "");
+  }
+  else
+  {
+    mmWaveHelper->EnableTraces ();
+  }
+
+  PrintHelper::PrintGnuplottableBuildingListToFile (filePath + "rooms.txt");
+  PrintHelper::PrintGnuplottableNodeListToFile (filePath + "nodes.txt");
+
+  // the positions of the nodes are sampled in a single event every mobilityInterval,
+  // scripts/convert_mobility_trace.pl converts them to the gnuplot labels of nodes.txt
+  Ptr<MobilitySnapshotWriter> mobilityWriter;
+  if (mobilityInterval > 0)
+  {
+    NS_ABORT_MSG_IF (mobilityNodes != "ues" && mobilityNodes != "all", "Unknown mobilityNodes " << mobilityNodes);
+    NodeContainer sampledNodes = (mobilityNodes == "all") ? NodeContainer::GetGlobal () : PrintHelper::GetUeNodes ();
+    mobilityWriter = Create<MobilitySnapshotWriter> (filePath + "mobility.bin", sampledNodes, MilliSeconds (mobilityInterval));
+    WarmStart::AddOutput (mobilityWriter, "mobility.bin");
+  }
+
+  // the simulation stops at the end of the first batch in which the KPIs
+  // of all the sinks have converged, or at the usual stop time otherwise
+  Ptr<ConvergenceMonitor> convergenceMonitor;
+  if (convergencePrecision > 0)
+  {
+    convergenceMonitor = Create<ConvergenceMonitor> (convergenceMetrics, MilliSeconds (convergenceBatch),
+                                                     convergencePrecision, MilliSeconds (convergenceMinTime));
+  }
 
-  AsciiTraceHelper ascii;
-  MobilityHelper::EnableAsciiAll (ascii.CreateFileStream ("mobility-trace-example.mob"));
+  // the memory of the process over the simulation time, to size the runs
+  Ptr<MemorySampler> memorySampler;
+  if (memoryInterval > 0)
+  {
+    memorySampler = Create<MemorySampler> (filePath + "memory.txt", MilliSeconds (memoryInterval));
+    WarmStart::AddOutput (memorySampler, "memory.txt");
+  }
 
-  PrintHelper::PrintGnuplottableBuildingListToFile ("rooms.txt");
-  PrintHelper::PrintGnuplottableNodeListToFile ("nodes.txt");
+  // the UEs which are not connected to their closest BS
+  Ptr<AssociationMonitor> associationMonitor;
+  if (associationInterval > 0)
+  {
+    associationMonitor = Create<AssociationMonitor> (filePath + "association.txt", MilliSeconds (associationInterval),
+                                                     ueDevs, (useIab ? iabDevs : donorDevs));
+    WarmStart::AddOutput (associationMonitor, "association.txt");
+    if (associationHandover)
+    {
+      associationMonitor->EnableHandover ();
+    }
+  }
 
   NS_LOG_DEBUG ("Simulation stops at " << maximumDuration << " seconds");
   Simulator::Stop(Seconds (maximumDuration));
   Simulator::Run();
 
+  if (convergenceMonitor)
+  {
+    convergenceMonitor->Report ();
+  }
+
+  if (memorySampler)
+  {
+    memorySampler->Close ();
+  }
+
+  if (associationMonitor)
+  {
+    associationMonitor->Report ();
+    associationMonitor->Close ();
+  }
+
+  if (traceAggregator)
+  {
+    traceAggregator->Close ();
+  }
+
+  if (mobilityWriter)
+  {
+    mobilityWriter->Close ();
+  }
+
+  if (ulWriter)
+  {
+    ulWriter->Close ();
+  }
+  if (flowStatsCollector)
+  {
+    flowStatsCollector->Dump ();
+  }
+
+
   return 0;
 }